@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "data/dataset.h"
+#include "data/synthetic.h"
+#include "data_structures/distribution.h"
+#include "data_structures/stopwatch.h"
+#include "decision_tree/decision_tree.h"
+#include "decision_tree/performance/performance.h"
+#include "decision_tree/training/genetic_algorithm.h"
+
+#define DEFAULT_REPETITIONS 11
+#define DEFAULT_WARM_UPS 2
+#define N_CROSSOVERS 64
+#define SEED 1
+
+
+/***********************************************************************
+ * Support functions.
+ **********************************************************************/
+
+/* Everything a kernel works on, prepared outside of timed sections;
+ * kernels pausing the stopwatch must restart it before returning */
+struct bench {
+    Dataset dataset;
+    FILE *csv;
+    DecisionTree tree;
+    DecisionTree other;
+    Status status;
+    unsigned int depth;
+    double epsilon;
+    Stopwatch stopwatch;
+    unsigned int checksum;
+};
+
+
+typedef void (*Kernel)(struct bench *bench);
+
+
+static const unsigned int sizes[] = {1000, 10000};
+static const unsigned int space_sizes[] = {4, 16};
+static const unsigned int depths[] = {4, 8};
+static const double epsilons[] = {0.0, 0.01, 0.05};
+
+
+
+static void display_usage(char *name) {
+    fprintf(stderr, "Usage: %s [repetitions [warm-ups]]\n", name);
+    fprintf(stderr, "Times hot kernels on synthetic datasets, reporting median and 95th percentile.\n");
+}
+
+
+
+static void kernel_dataset_load(struct bench *bench) {
+    Dataset dataset;
+
+    rewind(bench->csv);
+    dataset_load(bench->csv, &dataset);
+    bench->checksum += dataset.n_labels;
+    dataset_delete(dataset);
+}
+
+
+
+static void kernel_projections(struct bench *bench) {
+    dataset_compute_projections(&bench->dataset);
+    bench->checksum += bench->dataset.n_projections[0];
+}
+
+
+
+static void kernel_node_split(struct bench *bench) {
+    DecisionTree tree;
+
+    srand(SEED);
+    decision_tree_grow_random(&tree, bench->dataset, bench->depth);
+    stopwatch_pause(bench->stopwatch);
+    bench->checksum += decision_tree_n_nodes(tree);
+    decision_tree_delete(tree);
+    stopwatch_start(bench->stopwatch);
+}
+
+
+
+static void kernel_split_trial(struct bench *bench) {
+    DecisionTree tree;
+    unsigned int i;
+
+    stopwatch_pause(bench->stopwatch);
+    srand(SEED);
+    decision_tree_create(&tree, bench->dataset);
+    stopwatch_start(bench->stopwatch);
+    for (i = 0; i < bench->depth; ++i) {
+        mutation_grow(&tree, &bench->status);
+    }
+    stopwatch_pause(bench->stopwatch);
+    bench->checksum += decision_tree_n_nodes(tree);
+    decision_tree_delete(tree);
+    stopwatch_start(bench->stopwatch);
+}
+
+
+
+static void kernel_classify(struct bench *bench) {
+    const Dataset dataset = bench->dataset;
+    unsigned int i;
+
+    for (i = 0; i < dataset.size; ++i) {
+        bench->checksum += decision_tree_classify(bench->tree, dataset.points + i * dataset.space_size) & 1;
+    }
+}
+
+
+
+static void kernel_performance(struct bench *bench) {
+    Performance performance;
+
+    decision_tree_performance(&performance, bench->tree, bench->dataset, bench->epsilon);
+    bench->checksum += performance.stable;
+}
+
+
+
+static void kernel_crossover(struct bench *bench) {
+    DecisionTree offspring;
+    unsigned int i;
+
+    srand(SEED);
+    for (i = 0; i < N_CROSSOVERS; ++i) {
+        crossover_one_point(&offspring, bench->tree, bench->other, &bench->status);
+        bench->checksum += decision_tree_n_nodes(offspring);
+        decision_tree_delete(offspring);
+    }
+}
+
+
+
+static void kernel_generation(struct bench *bench) {
+    char *argv[] = {"bench-suite", "--max-iteration", "1", "--seed", "1"};
+    Status status;
+
+    ga_status_init(&status);
+    ga_parse_options(&status, sizeof(argv) / sizeof(argv[0]), argv);
+    bench->checksum += decision_tree_n_nodes(ga_train(&status, bench->dataset));
+    ga_status_clear(&status);
+}
+
+
+
+static void measure(
+    const char *name,
+    const Kernel kernel,
+    struct bench *bench,
+    const char *depth,
+    const double n_items,
+    const char *unit,
+    const unsigned int n_repetitions,
+    const unsigned int n_warm_ups
+) {
+    Distribution times;
+    double median;
+    unsigned int r;
+
+    distribution_create(&times, n_repetitions);
+    for (r = 0; r < n_warm_ups + n_repetitions; ++r) {
+        stopwatch_reset(bench->stopwatch);
+        kernel(bench);
+        stopwatch_stop(bench->stopwatch);
+        if (r >= n_warm_ups) {
+            times.values[r - n_warm_ups] = stopwatch_get_elapsed_time_milliseconds(bench->stopwatch);
+        }
+    }
+
+    median = distribution_median(&times);
+    printf("%-24s %7u %4u %5s %10.3f %10.3f %14.0f %s/s\n",
+           name, bench->dataset.size, bench->dataset.space_size, depth,
+           median, distribution_nth_percentile(&times, 95),
+           n_items / (median * 1e-3), unit);
+    fflush(stdout);
+    distribution_delete(times);
+}
+
+
+
+
+
+/***********************************************************************
+ * Main entry point.
+ **********************************************************************/
+
+int main(int argc, char *argv[]) {
+    unsigned int n_repetitions = DEFAULT_REPETITIONS,
+                 n_warm_ups = DEFAULT_WARM_UPS,
+                 i, j, k, e;
+    struct bench bench;
+
+    /* Checks input */
+    if (argc > 3 || (argc > 1 && atoi(argv[1]) <= 0)) {
+        display_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (argc > 1) {
+        n_repetitions = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        n_warm_ups = atoi(argv[2]);
+    }
+
+    stopwatch_create(&bench.stopwatch);
+    bench.checksum = 0;
+
+    printf("%-24s %7s %4s %5s %10s %10s %14s\n",
+           "kernel", "rows", "cols", "depth", "median ms", "p95 ms", "throughput");
+
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+        for (j = 0; j < sizeof(space_sizes) / sizeof(space_sizes[0]); ++j) {
+            SyntheticParameters parameters;
+
+            synthetic_parameters_init(&parameters);
+            parameters.size = sizes[i];
+            parameters.space_size = space_sizes[j];
+            parameters.seed = SEED;
+            synthetic_create(&bench.dataset, parameters);
+            bench.csv = tmpfile();
+            synthetic_write(bench.csv, parameters);
+
+            /* Status providing tree pool and allowed features to
+             * genetic operators */
+            ga_status_init(&bench.status);
+            bench.status.allowed_features = (unsigned int *) malloc(parameters.space_size * sizeof(unsigned int));
+            allow_features_all(bench.status.allowed_features, parameters.space_size, &bench.status);
+
+            measure("dataset_load", kernel_dataset_load, &bench, "-", sizes[i], "samples", n_repetitions, n_warm_ups);
+            measure("compute_projections", kernel_projections, &bench, "-", sizes[i], "samples", n_repetitions, n_warm_ups);
+
+            for (k = 0; k < sizeof(depths) / sizeof(depths[0]); ++k) {
+                char depth[16];
+
+                sprintf(depth, "%u", depths[k]);
+                bench.depth = depths[k];
+                srand(SEED);
+                decision_tree_grow_random(&bench.tree, bench.dataset, depths[k]);
+                decision_tree_grow_random(&bench.other, bench.dataset, depths[k]);
+
+                measure("node_split", kernel_node_split, &bench, depth, 1.0, "trees", n_repetitions, n_warm_ups);
+                measure("split_trial", kernel_split_trial, &bench, depth, depths[k], "splits", n_repetitions, n_warm_ups);
+                measure("decision_tree_classify", kernel_classify, &bench, depth, sizes[i], "samples", n_repetitions, n_warm_ups);
+                for (e = 0; e < sizeof(epsilons) / sizeof(epsilons[0]); ++e) {
+                    char name[32];
+
+                    sprintf(name, "performance eps=%g", epsilons[e]);
+                    bench.epsilon = epsilons[e];
+                    measure(name, kernel_performance, &bench, depth, sizes[i], "samples", n_repetitions, n_warm_ups);
+                }
+                measure("crossover_one_point", kernel_crossover, &bench, depth, N_CROSSOVERS, "offspring", n_repetitions, n_warm_ups);
+
+                decision_tree_delete(bench.tree);
+                decision_tree_delete(bench.other);
+            }
+
+            measure("ga_train generation", kernel_generation, &bench, "-", 1.0, "generations", n_repetitions, n_warm_ups);
+
+            free(bench.status.allowed_features);
+            ga_status_clear(&bench.status);
+            fclose(bench.csv);
+            dataset_delete(bench.dataset);
+        }
+    }
+
+    printf("Checksum: %u\n", bench.checksum);
+
+    /* Frees memory */
+    stopwatch_delete(&bench.stopwatch);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "data/dataset.h"
+#include "data_structures/counters.h"
+#include "data_structures/stopwatch.h"
+#include "decision_tree/decision_tree.h"
+#include "decision_tree/flat/flat_tree.h"
+#include "decision_tree/mapper/silva.h"
+
+#define DEFAULT_REPETITIONS 100
+
+
+/***********************************************************************
+ * Support function.
+ **********************************************************************/
+
+static void display_usage(char *name) {
+    fprintf(stderr, "Usage: %s model|random <dataset path> argument [repetitions]\n", name);
+    fprintf(stderr, "Arguments:\n");
+    fprintf(stderr, "  for \"model\":  path of tree to classify with\n");
+    fprintf(stderr, "  for \"random\": depth of a tree grown with random splits\n");
+}
+
+
+
+static void report(const char *name, const Stopwatch stopwatch, const unsigned int n_samples, const unsigned int checksum) {
+    const double seconds = stopwatch_get_elapsed_time_seconds(stopwatch);
+
+    printf("%-8s %10.3f ms  %14.0f samples/s  (checksum %u)\n", name, seconds * 1e3, n_samples / seconds, checksum);
+}
+
+
+
+
+
+/***********************************************************************
+ * Main entry point
+ **********************************************************************/
+
+int main(int argc, char **argv) {
+    const unsigned int is_counting = counters_requested(&argc, argv);
+    unsigned int i, r, n_repetitions = DEFAULT_REPETITIONS, checksum;
+    DecisionTree tree;
+    FlatTree flat_tree;
+    Dataset dataset;
+    Bitmask *labels;
+    Stopwatch stopwatch;
+    FILE *stream;
+
+    /* Checks input */
+    if (argc < 4) {
+        display_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (argc > 4) {
+        n_repetitions = atoi(argv[4]);
+    }
+
+    /* Reads dataset */
+    stream = fopen(argv[2], "r");
+    dataset_load(stream, &dataset);
+    fclose(stream);
+
+    /* Reads or grows decision tree */
+    if (strcmp(argv[1], "model") == 0) {
+        stream = fopen(argv[3], "r");
+        decision_tree_mapper_silva_load(stream, &tree, dataset);
+        fclose(stream);
+    }
+    else if (strcmp(argv[1], "random") == 0) {
+        srand(0);
+        decision_tree_grow_random(&tree, dataset, atoi(argv[3]));
+    }
+    else {
+        display_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    flat_tree_create(&flat_tree, tree);
+    labels = (Bitmask *) malloc(dataset.size * sizeof(Bitmask));
+    stopwatch_create(&stopwatch);
+
+    printf("Nodes: %u    depth: %u    samples: %u x %u    lanes: %u\n",
+           flat_tree.n_nodes, flat_tree.depth, dataset.size, n_repetitions, FLAT_TREE_LANES);
+
+    /* Linked nodes, one sample at a time */
+    checksum = 0;
+    stopwatch_reset(stopwatch);
+    for (r = 0; r < n_repetitions; ++r) {
+        for (i = 0; i < dataset.size; ++i) {
+            checksum += decision_tree_classify(tree, dataset.points + i * dataset.space_size) & 1;
+        }
+    }
+    stopwatch_stop(stopwatch);
+    report("node", stopwatch, dataset.size * n_repetitions, checksum);
+
+    /* Flat tree, one sample at a time */
+    checksum = 0;
+    stopwatch_reset(stopwatch);
+    for (r = 0; r < n_repetitions; ++r) {
+        for (i = 0; i < dataset.size; ++i) {
+            checksum += flat_tree_classify(flat_tree, dataset.points + i * dataset.space_size) & 1;
+        }
+    }
+    stopwatch_stop(stopwatch);
+    report("flat", stopwatch, dataset.size * n_repetitions, checksum);
+
+    /* Flat tree, lanes of samples */
+    checksum = 0;
+    stopwatch_reset(stopwatch);
+    for (r = 0; r < n_repetitions; ++r) {
+        flat_tree_classify_batch(labels, flat_tree, dataset.points, dataset.space_size, NULL, dataset.size);
+        for (i = 0; i < dataset.size; ++i) {
+            checksum += labels[i] & 1;
+        }
+    }
+    stopwatch_stop(stopwatch);
+    report("batch", stopwatch, dataset.size * n_repetitions, checksum);
+    if (is_counting) {
+        counters_print(stderr);
+    }
+
+    /* Frees memory */
+    stopwatch_delete(&stopwatch);
+    free(labels);
+    flat_tree_delete(flat_tree);
+    decision_tree_delete(tree);
+    dataset_delete(dataset);
+
+    return EXIT_SUCCESS;
+}
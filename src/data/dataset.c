@@ -4,6 +4,7 @@
 #include <ctype.h>
 
 #define LABEL_SIZE 32
+#define LINE_SIZE 4096
 
 
 /***********************************************************************
@@ -58,6 +59,7 @@ static void parse_header(
             }
             break;
 
+        case '\r':
         case '\n':
             *format = DATASET_CSV;
             result = fscanf(fh, "# %u %u", n_rows, n_cols);
@@ -119,7 +121,32 @@ static void dataset_read_csv(FILE *fh, Dataset *dataset) {
 
 
 
-static void compute_projections(Dataset *dataset) {
+/* Reads a whole line, growing buffer as needed; returns its length */
+static unsigned int read_line(DatasetStream *stream) {
+    unsigned int length = 0;
+
+    stream->line[0] = '\0';
+    while (fgets(stream->line + length, stream->line_size - length, stream->fh) != NULL) {
+        length += strlen(stream->line + length);
+        if (stream->line[length - 1] == '\n') {
+            break;
+        }
+        stream->line_size *= 2;
+        stream->line = (char *) realloc(stream->line, stream->line_size);
+    }
+
+    return length;
+}
+
+
+
+
+
+/***********************************************************************
+ * Public functions.
+ **********************************************************************/
+
+void dataset_compute_projections(Dataset *dataset) {
     const unsigned int space_size = dataset->space_size,
                        size = dataset->size;
     unsigned int i, j, k;
@@ -127,6 +154,9 @@ static void compute_projections(Dataset *dataset) {
     double **projections = dataset->projections;
 
     for (i = 0; i < space_size; ++i) {
+        free(projections[i]);
+        projections[i] = NULL;
+        n_projections[i] = 0;
         for (j = 0; j < size; ++j) {
             const double value = dataset->points[j * space_size + i];
 
@@ -148,12 +178,6 @@ static void compute_projections(Dataset *dataset) {
 
 
 
-
-
-/***********************************************************************
- * Public functions.
- **********************************************************************/
-
 void dataset_create(Dataset *dataset, const unsigned int space_size, const unsigned int size) {
     unsigned int i;
 
@@ -214,7 +238,83 @@ void dataset_load(FILE *fh, Dataset *dataset) {
             abort();
     }
 
-    compute_projections(dataset);
+    dataset_compute_projections(dataset);
+}
+
+
+
+void dataset_stream_open(DatasetStream *stream, FILE *fh) {
+    DatasetFormat format;
+
+    if (!fh) {
+        fprintf(stderr, "[%s: %d] Cannot read dataset file.\n", __FILE__, __LINE__);
+        abort();
+    }
+
+    parse_header(&format, &stream->size, &stream->space_size, fh);
+    if (format != DATASET_CSV) {
+        fprintf(stderr, "Unknown dataset type.\n");
+        abort();
+    }
+
+    stream->fh = fh;
+    stream->n_read = 0;
+    stream->line_size = LINE_SIZE;
+    stream->line = (char *) malloc(stream->line_size);
+}
+
+
+
+unsigned int dataset_stream_read(DatasetStream *stream, double *points, const unsigned int n) {
+    unsigned int i = 0, j;
+
+    while (i < n && stream->n_read < stream->size) {
+        unsigned int length = read_line(stream);
+        char *c;
+
+        if (length == 0) {
+            break;
+        }
+
+        /* Drops line terminator, either "\n" or "\r\n" */
+        while (length > 0 && (stream->line[length - 1] == '\n' || stream->line[length - 1] == '\r')) {
+            stream->line[--length] = '\0';
+        }
+        if (length == 0) {
+            continue;
+        }
+
+        /* Skips label, then parses features */
+        c = strchr(stream->line, ',');
+        for (j = 0; j < stream->space_size; ++j) {
+            char *end;
+
+            if (c == NULL) {
+                fprintf(stderr, "[%s: %d] Row %u has less than %u features.\n", __FILE__, __LINE__, stream->n_read + 1, stream->space_size);
+                abort();
+            }
+            points[i * stream->space_size + j] = strtod(c + 1, &end);
+            while (*end == ' ' || *end == '\t') {
+                ++end;
+            }
+            if (end == c + 1 || (*end != ',' && *end != '\0')) {
+                fprintf(stderr, "[%s: %d] Row %u has a malformed feature %u.\n", __FILE__, __LINE__, stream->n_read + 1, j + 1);
+                abort();
+            }
+            c = strchr(end, ',');
+        }
+        ++stream->n_read;
+        ++i;
+    }
+
+    return i;
+}
+
+
+
+void dataset_stream_close(DatasetStream *stream) {
+    free(stream->line);
+    stream->line = NULL;
 }
 
 
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 
 typedef struct dataset Dataset;
+typedef struct dataset_stream DatasetStream;
 
 struct dataset {
     unsigned int space_size;
@@ -18,12 +19,31 @@ struct dataset {
 };
 
 
+/* Reads rows of a dataset file a chunk at a time, labels are skipped */
+struct dataset_stream {
+    FILE *fh;
+    unsigned int space_size;
+    unsigned int size;
+    unsigned int n_read;
+    char *line;
+    unsigned int line_size;
+};
+
+
 void dataset_create(Dataset *dataset, const unsigned int space_size, const unsigned int size);
 
 void dataset_delete(Dataset dataset);
 
 void dataset_load(FILE *fh, Dataset *dataset);
 
+void dataset_compute_projections(Dataset *dataset);
+
+void dataset_stream_open(DatasetStream *stream, FILE *fh);
+
+unsigned int dataset_stream_read(DatasetStream *stream, double *points, const unsigned int n);
+
+void dataset_stream_close(DatasetStream *stream);
+
 unsigned int dataset_label_lookup(const Dataset dataset, const double point[]);
 
 void dataset_print(FILE *fh, const Dataset dataset);
@@ -0,0 +1,188 @@
+#include "synthetic.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define DEFAULT_SIZE 1000
+#define DEFAULT_SPACE_SIZE 4
+#define DEFAULT_N_LABELS 2
+#define DEFAULT_N_CLUSTERS 1
+#define DEFAULT_SPREAD 0.15
+#define DEFAULT_LABEL_NOISE 0.0
+#define DEFAULT_N_DUPLICATED_FEATURES 0
+#define DEFAULT_N_VALUES 0
+#define DEFAULT_SEED 0
+#define GOLDEN_GAMMA 0x9E3779B97F4A7C15UL
+#define LABEL_SIZE 32
+#define RESOLUTION 100.0
+#define VALUE_SIZE 32
+
+
+/***********************************************************************
+ * Internal functions.
+ **********************************************************************/
+
+/* SplitMix64, so that streams do not depend on the C library */
+static unsigned long next_random(unsigned long *state) {
+    unsigned long z = (*state += GOLDEN_GAMMA);
+
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9UL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBUL;
+
+    return z ^ (z >> 31);
+}
+
+
+
+static double next_uniform(unsigned long *state) {
+    return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+
+static double quantize(const double x, const unsigned int n_values) {
+    double level;
+
+    /* Rounding by division keeps values equal to their printed form */
+    if (n_values == 0) {
+        return floor(x * RESOLUTION + 0.5) / RESOLUTION;
+    }
+    if (n_values == 1) {
+        return 0.0;
+    }
+
+    level = floor(x * (n_values - 1) + 0.5);
+    level = level < 0.0 ? 0.0 : (level > n_values - 1 ? n_values - 1 : level);
+
+    return level / (n_values - 1);
+}
+
+
+
+static void synthetic_row(double *point, unsigned int *label, const SyntheticParameters parameters, const unsigned long row) {
+    const unsigned int n_original = parameters.space_size - parameters.n_duplicated_features;
+    unsigned long state = parameters.seed ^ (row * 0xD1B54A32D192ED03UL);
+    unsigned int cluster, j;
+
+    *label = next_random(&state) % parameters.n_labels;
+    cluster = *label * parameters.n_clusters + next_random(&state) % parameters.n_clusters;
+    for (j = 0; j < n_original; ++j) {
+        unsigned long centre_state = parameters.seed ^ ((cluster * (unsigned long) parameters.space_size + j + 1) * GOLDEN_GAMMA);
+        const double centre = next_uniform(&centre_state),
+                     offset = next_uniform(&state) + next_uniform(&state) + next_uniform(&state) - 1.5;
+
+        point[j] = quantize(centre + parameters.spread * offset, parameters.n_values);
+    }
+    for (; j < parameters.space_size; ++j) {
+        point[j] = point[j % n_original];
+    }
+
+    if (parameters.label_noise > 0.0 && next_uniform(&state) < parameters.label_noise) {
+        *label = next_random(&state) % parameters.n_labels;
+    }
+}
+
+
+
+/* Hundredths are written from their integer numerator, which is much
+ * faster than formatting doubles; other values use the shortest of two
+ * precisions which reads back as the same double */
+static void write_value(FILE *fh, const double x, const unsigned int n_values) {
+    char buffer[VALUE_SIZE], *c = buffer + VALUE_SIZE;
+
+    if (n_values == 0) {
+        const long k = (long) floor(x * RESOLUTION + 0.5);
+        unsigned long magnitude = k < 0 ? -k : k;
+        const unsigned long fraction = magnitude % 100;
+
+        *--c = '\0';
+        if (fraction % 10 != 0) {
+            *--c = '0' + fraction % 10;
+        }
+        if (fraction != 0) {
+            *--c = '0' + fraction / 10;
+            *--c = '.';
+        }
+        magnitude /= 100;
+        do {
+            *--c = '0' + magnitude % 10;
+            magnitude /= 10;
+        } while (magnitude > 0);
+        if (k < 0) {
+            *--c = '-';
+        }
+        fputs(c, fh);
+        return;
+    }
+
+    sprintf(buffer, "%.15g", x);
+    if (strtod(buffer, NULL) != x) {
+        sprintf(buffer, "%.17g", x);
+    }
+    fputs(buffer, fh);
+}
+
+
+
+
+
+/***********************************************************************
+ * Public functions.
+ **********************************************************************/
+
+void synthetic_parameters_init(SyntheticParameters *parameters) {
+    parameters->size = DEFAULT_SIZE;
+    parameters->space_size = DEFAULT_SPACE_SIZE;
+    parameters->n_labels = DEFAULT_N_LABELS;
+    parameters->n_clusters = DEFAULT_N_CLUSTERS;
+    parameters->spread = DEFAULT_SPREAD;
+    parameters->label_noise = DEFAULT_LABEL_NOISE;
+    parameters->n_duplicated_features = DEFAULT_N_DUPLICATED_FEATURES;
+    parameters->n_values = DEFAULT_N_VALUES;
+    parameters->seed = DEFAULT_SEED;
+}
+
+
+
+void synthetic_create(Dataset *dataset, const SyntheticParameters parameters) {
+    unsigned int i;
+
+    dataset_create(dataset, parameters.space_size, parameters.size);
+
+    dataset->n_labels = parameters.n_labels;
+    dataset->labels = (char **) malloc(parameters.n_labels * sizeof(char *));
+    for (i = 0; i < parameters.n_labels; ++i) {
+        char buffer[LABEL_SIZE];
+
+        sprintf(buffer, "%u", i);
+        dataset->labels[i] = (char *) malloc(strlen(buffer) + 1);
+        strcpy(dataset->labels[i], buffer);
+    }
+
+    for (i = 0; i < parameters.size; ++i) {
+        synthetic_row(dataset->points + i * parameters.space_size, dataset->label_lookup + i, parameters, i);
+    }
+
+    dataset_compute_projections(dataset);
+}
+
+
+
+void synthetic_write(FILE *fh, const SyntheticParameters parameters) {
+    double *point = (double *) malloc(parameters.space_size * sizeof(double));
+    unsigned int i, j, label;
+
+    fprintf(fh, "# %u %u\n", parameters.size, parameters.space_size);
+    for (i = 0; i < parameters.size; ++i) {
+        synthetic_row(point, &label, parameters, i);
+        fprintf(fh, "%u", label);
+        for (j = 0; j < parameters.space_size; ++j) {
+            fputc(',', fh);
+            write_value(fh, point[j], parameters.n_values);
+        }
+        fputc('\n', fh);
+    }
+
+    free(point);
+}
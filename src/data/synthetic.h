@@ -0,0 +1,35 @@
+#ifndef DATA_SYNTHETIC_H
+#define DATA_SYNTHETIC_H
+
+#include <stdio.h>
+
+#include "dataset.h"
+
+/* Synthetic datasets: every label is a mixture of blobs around random
+ * centres of the unit hypercube, values are rounded to hundredths or
+ * snapped to a fixed number of levels. A row depends only on seed and
+ * row index, so the same rows are produced whether they are generated
+ * in memory or streamed to a file. */
+
+typedef struct synthetic_parameters SyntheticParameters;
+
+struct synthetic_parameters {
+    unsigned int size;
+    unsigned int space_size;
+    unsigned int n_labels;
+    unsigned int n_clusters;             /* Blobs per label */
+    double spread;
+    double label_noise;                  /* Probability of a uniformly drawn label */
+    unsigned int n_duplicated_features;  /* Trailing features copying leading ones */
+    unsigned int n_values;               /* Levels per feature in [0; 1], 0 for hundredths */
+    unsigned long seed;
+};
+
+
+void synthetic_parameters_init(SyntheticParameters *parameters);
+
+void synthetic_create(Dataset *dataset, const SyntheticParameters parameters);
+
+void synthetic_write(FILE *fh, const SyntheticParameters parameters);
+
+#endif
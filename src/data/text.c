@@ -0,0 +1,96 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include "text.h"
+
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define READ_CHUNK_SIZE (1 << 16)
+
+
+/***********************************************************************
+ * Internal functions.
+ **********************************************************************/
+
+static void read_all(Text *text, FILE *fh) {
+    size_t size = 0, capacity = READ_CHUNK_SIZE, n;
+    char *buffer = (char *) malloc(capacity), *grown;
+
+    if (buffer == NULL) {
+        fprintf(stderr, "[%s: %d] Cannot allocate memory.\n", __FILE__, __LINE__);
+        abort();
+    }
+    while ((n = fread(buffer + size, 1, capacity - size, fh)) > 0) {
+        size += n;
+        if (size == capacity) {
+            capacity *= 2;
+            grown = (char *) realloc(buffer, capacity);
+            if (grown == NULL) {
+                free(buffer);
+                fprintf(stderr, "[%s: %d] Cannot allocate memory.\n", __FILE__, __LINE__);
+                abort();
+            }
+            buffer = grown;
+        }
+    }
+
+    text->data = buffer;
+    text->end = buffer + size;
+    text->mapping = NULL;
+}
+
+
+
+
+
+/***********************************************************************
+ * Public functions.
+ **********************************************************************/
+
+void text_open(Text *text, FILE *fh) {
+    struct stat status;
+
+    if (!fh) {
+        fprintf(stderr, "[%s: %d] Cannot read file.\n", __FILE__, __LINE__);
+        abort();
+    }
+
+    text->fh = fh;
+    text->offset = ftell(fh);
+    text->mapping = NULL;
+
+    /* Whole file is mapped, since mappings start at page boundaries */
+    if (text->offset >= 0 && fstat(fileno(fh), &status) == 0
+        && S_ISREG(status.st_mode) && status.st_size > text->offset) {
+        text->mapping_size = status.st_size;
+        text->mapping = mmap(NULL, text->mapping_size, PROT_READ, MAP_PRIVATE, fileno(fh), 0);
+        if (text->mapping == MAP_FAILED) {
+            text->mapping = NULL;
+        }
+    }
+
+    if (text->mapping) {
+        text->data = (const char *) text->mapping + text->offset;
+        text->end = (const char *) text->mapping + text->mapping_size;
+    }
+    else {
+        read_all(text, fh);
+    }
+}
+
+
+
+void text_close(Text *text, const char *position) {
+    /* Leaves the file right after what was parsed, when it can seek */
+    if (text->offset >= 0) {
+        fseek(text->fh, text->offset + (position - text->data), SEEK_SET);
+    }
+
+    if (text->mapping) {
+        munmap(text->mapping, text->mapping_size);
+    }
+    else {
+        free((char *) text->data);
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef DATA_TEXT_H
+#define DATA_TEXT_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/* Rest of a file from its current position, mapped in memory when the
+ * file is regular and read into a buffer otherwise. Text is not NUL
+ * terminated, parsers must stop at end. */
+
+typedef struct text Text;
+
+struct text {
+    const char *data;
+    const char *end;
+    FILE *fh;
+    long offset;
+    void *mapping;
+    size_t mapping_size;
+};
+
+
+void text_open(Text *text, FILE *fh);
+
+void text_close(Text *text, const char *position);
+
+#endif
@@ -0,0 +1,80 @@
+/**
+ * Implements counters of work done by hot kernels.
+ *
+ * @file counters.c
+ * @author Marco Zanella <marco.zanella.1991@gmail.com>
+ */
+#include "counters.h"
+
+#include <string.h>
+
+
+#ifdef COUNTERS
+__thread unsigned long counters_local[COUNTER_N_COUNTERS];
+
+/** Totals merged from every thread. */
+static unsigned long counters_total[COUNTER_N_COUNTERS];
+#endif
+
+
+
+void counters_merge(void) {
+#ifdef COUNTERS
+    unsigned int i;
+
+    for (i = 0; i < COUNTER_N_COUNTERS; ++i) {
+        __sync_fetch_and_add(counters_total + i, counters_local[i]);
+        counters_local[i] = 0;
+    }
+#endif
+}
+
+
+
+void counters_print(FILE *fh) {
+#ifdef COUNTERS
+    static const char *names[COUNTER_N_COUNTERS] = {
+        "Classified samples",
+        "Classify nodes traversed",
+        "Stability samples",
+        "Stability pushes",
+        "Split scores",
+        "Split samples scanned",
+        "Node splits",
+        "Node split samples",
+        "Node split moves"
+    };
+    unsigned int i;
+
+    counters_merge();
+    fprintf(fh, "Counters:\n");
+    for (i = 0; i < COUNTER_N_COUNTERS; ++i) {
+        fprintf(fh, "  %-26s %lu\n", names[i], counters_total[i]);
+    }
+    if (counters_total[COUNTER_CLASSIFIED_SAMPLES] > 0) {
+        fprintf(fh, "  %-26s %g\n", "Nodes per classification",
+                (double) counters_total[COUNTER_CLASSIFY_NODES] / counters_total[COUNTER_CLASSIFIED_SAMPLES]);
+    }
+#else
+    fprintf(fh, "Counters are not available, rebuild with \"make COUNTERS=1\".\n");
+#endif
+}
+
+
+
+unsigned int counters_requested(int *argc, char **argv) {
+    unsigned int is_requested = 0;
+    int i, j;
+
+    for (i = 0, j = 0; i < *argc; ++i) {
+        if (strcmp(argv[i], "--counters") == 0) {
+            is_requested = 1;
+        }
+        else {
+            argv[j++] = argv[i];
+        }
+    }
+    *argc = j;
+
+    return is_requested;
+}
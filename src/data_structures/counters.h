@@ -0,0 +1,67 @@
+/**
+ * Defines counters of work done by hot kernels.
+ *
+ * Counting is compiled in only when COUNTERS is defined (make
+ * COUNTERS=1); otherwise #counter_add expands to nothing. Each thread
+ * counts on its own copy, which is added to the totals by
+ * #counters_merge.
+ *
+ * @file counters.h
+ * @author Marco Zanella <marco.zanella.1991@gmail.com>
+ */
+#ifndef COUNTERS_H
+#define COUNTERS_H
+
+#include <stdio.h>
+
+/** Quantities being counted. */
+enum counter {
+    COUNTER_CLASSIFIED_SAMPLES,    /**< Samples classified. */
+    COUNTER_CLASSIFY_NODES,        /**< Split nodes traversed while classifying. */
+    COUNTER_STABILITY_SAMPLES,     /**< Samples checked for stability. */
+    COUNTER_STABILITY_PUSHES,      /**< Reachability masks or nodes pushed while checking stability. */
+    COUNTER_SPLIT_SCORES,          /**< Candidate splits scored. */
+    COUNTER_SPLIT_SAMPLES_SCANNED, /**< Samples scanned while scoring splits. */
+    COUNTER_NODE_SPLITS,           /**< Calls to node_split. */
+    COUNTER_NODE_SPLIT_SAMPLES,    /**< Samples partitioned by node_split. */
+    COUNTER_NODE_SPLIT_MOVES,      /**< Partition elements moved by node_split. */
+    COUNTER_N_COUNTERS
+};
+
+#ifdef COUNTERS
+/** Counts of the calling thread, not yet merged. */
+extern __thread unsigned long counters_local[COUNTER_N_COUNTERS];
+
+#define counter_add(counter, n) (counters_local[counter] += (n))
+#else
+#define counter_add(counter, n)
+#endif
+
+
+/**
+ * Adds counts of the calling thread to the totals, and clears them.
+ *
+ * Every thread should call it before exiting.
+ */
+void counters_merge(void);
+
+
+/**
+ * Prints totals, after merging counts of the calling thread.
+ *
+ * @param[out] fh Stream to print to
+ */
+void counters_print(FILE *fh);
+
+
+/**
+ * Tells whether counters were requested on command line, removing the
+ * request ("--counters") from arguments.
+ *
+ * @param[in,out] argc Number of arguments
+ * @param[in,out] argv Arguments
+ * @return 1 if counters were requested, 0 otherwise
+ */
+unsigned int counters_requested(int *argc, char **argv);
+
+#endif
@@ -1,9 +1,11 @@
 /**
- * Implements a stopwatch to measure CPU time.
+ * Implements a stopwatch to measure wall-clock time.
  *
  * @file stopwatch.h
  * @author Marco Zanella <marco.zanella.1991@gmail.com>
  */
+#define _POSIX_C_SOURCE 199309L
+
 #include "stopwatch.h"
 
 #include <stdio.h>
@@ -13,12 +15,27 @@
 
 /** Structure of a stopwatch. */
 struct stopwatch {
-    double elapsed_time;  /**< Elapsed time, in milliseconds. */
-    clock_t start_clock;  /**< Start clock. */
+    double elapsed_time;  /**< Elapsed time, in seconds. */
+    double start_time;    /**< Start time, in seconds. */
 };
 
 
 
+/**
+ * Reads monotonic clock.
+ *
+ * @return Time from an arbitrary origin, in seconds
+ */
+static double now(void) {
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+
+
 void stopwatch_create(Stopwatch *S) {
     Stopwatch s = (Stopwatch) malloc(sizeof(struct stopwatch));
     if (s == NULL) {
@@ -27,7 +44,7 @@ void stopwatch_create(Stopwatch *S) {
     }
 
     s->elapsed_time = 0.0;
-    s->start_clock = clock();
+    s->start_time = now();
 
     *S = s;
 }
@@ -70,7 +87,7 @@ void stopwatch_reset(Stopwatch S) {
     }
 
     S->elapsed_time = 0.0;
-    S->start_clock = clock();
+    S->start_time = now();
 }
 
 
@@ -81,7 +98,7 @@ void stopwatch_start(Stopwatch S) {
         abort();
     }
 
-    S->start_clock = clock();
+    S->start_time = now();
 }
 
 
@@ -92,7 +109,7 @@ void stopwatch_pause(Stopwatch S) {
         abort();
     }
 
-    S->elapsed_time += (double) (clock() - S->start_clock) / (double) CLOCKS_PER_SEC;
+    S->elapsed_time += now() - S->start_time;
 }
 
 
@@ -1,5 +1,8 @@
 /**
- * Defines a stopwatch to measure CPU time.
+ * Defines a stopwatch to measure wall-clock time.
+ *
+ * Time is read from a monotonic clock, so it keeps counting while
+ * several threads run and is not affected by changes to system time.
  *
  * @file stopwatch.h
  * @author Marco Zanella <marco.zanella.1991@gmail.com>
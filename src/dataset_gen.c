@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "data/synthetic.h"
+
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+
+/***********************************************************************
+ * Support functions.
+ **********************************************************************/
+
+static void display_usage(char *name) {
+    fprintf(stderr, "Usage: %s <output path|-> [options]\n", name);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --rows n                 Number of samples\n");
+    fprintf(stderr, "  --features n             Number of features\n");
+    fprintf(stderr, "  --labels n               Number of labels\n");
+    fprintf(stderr, "  --clusters n             Number of blobs per label\n");
+    fprintf(stderr, "  --spread s               Width of every blob\n");
+    fprintf(stderr, "  --label-noise p          Probability of replacing a label with a uniformly drawn one\n");
+    fprintf(stderr, "  --duplicated-features n  Number of trailing features copying leading ones\n");
+    fprintf(stderr, "  --values n               Distinct values per feature, 0 to round to hundredths\n");
+    fprintf(stderr, "  --seed n                 Seed, equal seeds produce equal datasets\n");
+}
+
+
+
+static void parse_options(SyntheticParameters *parameters, int argc, char **argv) {
+    int i;
+
+    for (i = 2; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            fprintf(stderr, "[%s: %d] Missing value of option \"%s\".\n", __FILE__, __LINE__, argv[i]);
+            exit(EXIT_FAILURE);
+        }
+
+        if (strcmp(argv[i], "--rows") == 0) {
+            parameters->size = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--features") == 0) {
+            parameters->space_size = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--labels") == 0) {
+            parameters->n_labels = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--clusters") == 0) {
+            parameters->n_clusters = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--spread") == 0) {
+            parameters->spread = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--label-noise") == 0) {
+            parameters->label_noise = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--duplicated-features") == 0) {
+            parameters->n_duplicated_features = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--values") == 0) {
+            parameters->n_values = strtoul(argv[++i], NULL, 10);
+        }
+        else if (strcmp(argv[i], "--seed") == 0) {
+            parameters->seed = strtoul(argv[++i], NULL, 10);
+        }
+        else {
+            fprintf(stderr, "[%s: %d] Unknown option \"%s\".\n", __FILE__, __LINE__, argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (parameters->space_size == 0 || parameters->n_labels == 0 || parameters->n_clusters == 0) {
+        fprintf(stderr, "[%s: %d] Features, labels and clusters must be positive.\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    if (parameters->n_duplicated_features >= parameters->space_size) {
+        fprintf(stderr, "[%s: %d] At least one feature must not be duplicated.\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    if (parameters->label_noise < 0.0 || parameters->label_noise > 1.0) {
+        fprintf(stderr, "[%s: %d] Label noise must be in [0; 1].\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+
+
+
+/***********************************************************************
+ * Main entry point.
+ **********************************************************************/
+
+int main(int argc, char *argv[]) {
+    SyntheticParameters parameters;
+    char *buffer;
+    FILE *stream;
+
+    /* Checks input */
+    if (argc < 2) {
+        display_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    synthetic_parameters_init(&parameters);
+    parse_options(&parameters, argc, argv);
+
+    /* Streams rows, so that size is bounded only by disk space */
+    stream = strcmp(argv[1], "-") == 0 ? stdout : fopen(argv[1], "w");
+    if (stream == NULL) {
+        fprintf(stderr, "[%s: %d] Cannot open \"%s\" for writing.\n", __FILE__, __LINE__, argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    buffer = (char *) malloc(OUTPUT_BUFFER_SIZE);
+    setvbuf(stream, buffer, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    synthetic_write(stream, parameters);
+
+    if (fclose(stream) != 0) {
+        fprintf(stderr, "[%s: %d] Cannot write \"%s\".\n", __FILE__, __LINE__, argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    free(buffer);
+
+    return EXIT_SUCCESS;
+}
@@ -4,13 +4,49 @@
 #include <string.h>
 #include <math.h>
 
+#include "../data_structures/counters.h"
 #include "../data_structures/stack.h"
+#include "flat/flat_tree.h"
+
+#define SIMILARITY_BLOCK_SIZE 256
+#define RANDOM_SPLIT_ATTEMPTS 8
+#define FNV_OFFSET_BASIS 14695981039346656037UL
+#define FNV_PRIME 1099511628211UL
 
 
 /***********************************************************************
  * Internal functions.
  **********************************************************************/
 
+static unsigned long fnv_hash(unsigned long hash, const void *data, const unsigned int size) {
+    const unsigned char *bytes = (const unsigned char *) data;
+    unsigned int i;
+
+    for (i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
+
+
+
+static Node *node_alloc(const DecisionTree *tree) {
+    Node *node;
+
+    if (tree->pool && !stack_is_empty(tree->pool->nodes)) {
+        return stack_pop(tree->pool->nodes);
+    }
+
+    node = (Node *) malloc(sizeof(Node));
+    node->frequencies = (unsigned int *) malloc(tree->dataset.n_labels * sizeof(unsigned int));
+    node->probabilities = (double *) malloc(tree->dataset.n_labels * sizeof(double));
+
+    return node;
+}
+
+
+
 static void node_create(
     Node *node,
     const DecisionTree *tree,
@@ -24,8 +60,6 @@ static void node_create(
     node->right = NULL;
     node->feature = 0;
     node->threshold = 0.0;
-    node->frequencies = (unsigned int *) malloc(tree->dataset.n_labels * sizeof(unsigned int));
-    node->probabilities = (double *) malloc(tree->dataset.n_labels * sizeof(double));
     node->labels = BITMASK_NOTHING;
     node->first_sample_idx = 0;
     node->last_sample_idx = 0;
@@ -37,22 +71,27 @@ static void node_create(
 }
 
 
-static void node_delete(Node *node) {
+static void node_delete(Node *node, TreePool *pool) {
     Stack S;
 
     stack_create(&S);
     stack_push(S, node);
     while (!stack_is_empty(S)) {
         node = stack_pop(S);
-        free(node->frequencies);
-        free(node->probabilities);
         if (node->left) {
             stack_push(S, node->left);
         }
         if (node->right) {
             stack_push(S, node->right);
         }
-        free(node);
+        if (pool) {
+            stack_push(pool->nodes, node);
+        }
+        else {
+            free(node->frequencies);
+            free(node->probabilities);
+            free(node);
+        }
     }
     stack_delete(&S);
 }
@@ -67,10 +106,11 @@ void decision_tree_create(DecisionTree *tree, const Dataset dataset) {
     unsigned int i, max = 0;
     Node *root;
 
-    root = (Node *) malloc(sizeof(Node));
-    tree->root = root;
     tree->dataset = dataset;
-    tree->samples = (double **) malloc(dataset.size * sizeof(double *));
+    tree->pool = NULL;
+    partition_create(&tree->samples, dataset.size, NULL);
+    root = node_alloc(tree);
+    tree->root = root;
 
     node_create(root, tree, NULL);
     for (i = 0; i < dataset.size; ++i) {
@@ -79,7 +119,7 @@ void decision_tree_create(DecisionTree *tree, const Dataset dataset) {
         if (frequency > max) {
             max = frequency;
         }
-        tree->samples[i] = dataset.points + i * dataset.space_size;
+        partition_set(tree->samples, i, i);
     }
 
     for (i = 0; i < dataset.n_labels; ++i) {
@@ -88,14 +128,97 @@ void decision_tree_create(DecisionTree *tree, const Dataset dataset) {
         }
     }
 
-    root->last_sample_idx = dataset.size - 1;
+    root->last_sample_idx = dataset.size > 0 ? dataset.size - 1 : 0;
+}
+
+
+
+void decision_tree_copy(DecisionTree *copy, const DecisionTree tree, TreePool *pool) {
+    const unsigned int n_labels = tree.dataset.n_labels;
+    Node *root;
+    Stack S_tree, S_copy;
+
+    copy->dataset = tree.dataset;
+    copy->pool = pool;
+    partition_share(&copy->samples, tree.samples, pool);
+    root = node_alloc(copy);
+    copy->root = root;
+    node_create(root, copy, NULL);
+
+    stack_create(&S_tree);
+    stack_create(&S_copy);
+    stack_push(S_tree, tree.root);
+    stack_push(S_copy, root);
+    while (!stack_is_empty(S_tree)) {
+        const Node *node = stack_pop(S_tree);
+        Node *node_copy = stack_pop(S_copy);
+
+        node_copy->feature = node->feature;
+        node_copy->threshold = node->threshold;
+        node_copy->labels = node->labels;
+        node_copy->first_sample_idx = node->first_sample_idx;
+        node_copy->last_sample_idx = node->last_sample_idx;
+        memcpy(node_copy->frequencies, node->frequencies, n_labels * sizeof(unsigned int));
+        memcpy(node_copy->probabilities, node->probabilities, n_labels * sizeof(double));
+
+        if (node->left) {
+            node_copy->left = node_alloc(copy);
+            node_create(node_copy->left, copy, node_copy);
+            stack_push(S_tree, node->left);
+            stack_push(S_copy, node_copy->left);
+        }
+        if (node->right) {
+            node_copy->right = node_alloc(copy);
+            node_create(node_copy->right, copy, node_copy);
+            stack_push(S_tree, node->right);
+            stack_push(S_copy, node_copy->right);
+        }
+    }
+    stack_delete(&S_tree);
+    stack_delete(&S_copy);
 }
 
 
 
 void decision_tree_delete(DecisionTree tree) {
-    node_delete(tree.root);
-    free(tree.samples);
+    node_delete(tree.root, tree.pool);
+    partition_delete(tree.samples);
+}
+
+
+
+void decision_tree_partition(DecisionTree *tree, const Dataset dataset) {
+    DecisionTree model = *tree;
+    Stack S_model, S_tree;
+
+    /* Replays splits of the model on the dataset, splits sending every
+     * sample to one side are collapsed into the surviving child */
+    decision_tree_create(tree, dataset);
+    stack_create(&S_model);
+    stack_create(&S_tree);
+    stack_push(S_model, model.root);
+    stack_push(S_tree, tree->root);
+    while (!stack_is_empty(S_model)) {
+        const Node *model_node = stack_pop(S_model);
+        Node *node = stack_pop(S_tree);
+
+        while (!node_is_leaf(*model_node)) {
+            const SplitResult result = node_split(node, model_node->feature, model_node->threshold);
+
+            if (result == SPLIT_BOTH) {
+                stack_push(S_model, model_node->right);
+                stack_push(S_tree, node->right);
+                stack_push(S_model, model_node->left);
+                stack_push(S_tree, node->left);
+                break;
+            }
+            model_node = result == SPLIT_LEFT ? model_node->left : model_node->right;
+        }
+    }
+    stack_delete(&S_model);
+    stack_delete(&S_tree);
+
+    decision_tree_delete(model);
 }
 
 
@@ -112,6 +235,104 @@ unsigned int decision_tree_n_leaves(const DecisionTree tree) {
 
 
 
+void decision_tree_grow_random(DecisionTree *tree, const Dataset dataset, const unsigned int depth) {
+    Stack S;
+
+    decision_tree_create(tree, dataset);
+
+    stack_create(&S);
+    stack_push(S, tree->root);
+    while (!stack_is_empty(S)) {
+        Node *node = stack_pop(S);
+        const unsigned int n = node->last_sample_idx - node->first_sample_idx + 1;
+        unsigned int i;
+
+        if (node_depth(*node) >= depth || n < 2) {
+            continue;
+        }
+
+        /* Threshold is a random value of a random feature in the node */
+        for (i = 0; i < RANDOM_SPLIT_ATTEMPTS; ++i) {
+            const unsigned int feature = rand() % dataset.space_size,
+                               idx = node->first_sample_idx + rand() % n,
+                               sample = partition_get(tree->samples, idx);
+
+            if (node_split(node, feature, dataset.points[sample * dataset.space_size + feature]) == SPLIT_BOTH) {
+                stack_push(S, node->left);
+                stack_push(S, node->right);
+                break;
+            }
+        }
+    }
+    stack_delete(&S);
+}
+
+
+
+unsigned long decision_tree_fingerprint(const DecisionTree tree) {
+    unsigned long hash = FNV_OFFSET_BASIS;
+    Stack S;
+
+    /* Hashes nodes in preorder, so equal structures give equal values */
+    stack_create(&S);
+    stack_push(S, tree.root);
+    while (!stack_is_empty(S)) {
+        const Node *node = stack_pop(S);
+        const unsigned char is_leaf = node_is_leaf(*node);
+
+        hash = fnv_hash(hash, &is_leaf, sizeof(is_leaf));
+        if (is_leaf) {
+            hash = fnv_hash(hash, &node->labels, sizeof(node->labels));
+        }
+        else {
+            hash = fnv_hash(hash, &node->feature, sizeof(node->feature));
+            hash = fnv_hash(hash, &node->threshold, sizeof(node->threshold));
+            stack_push(S, node->right);
+            stack_push(S, node->left);
+        }
+    }
+    stack_delete(&S);
+
+    return hash;
+}
+
+
+
+unsigned int decision_tree_is_equal(const DecisionTree tree_1, const DecisionTree tree_2) {
+    unsigned int is_equal = 1;
+    Stack S;
+
+    /* Walks both trees in preorder, nodes are pushed in pairs */
+    stack_create(&S);
+    stack_push(S, tree_1.root);
+    stack_push(S, tree_2.root);
+    while (is_equal && !stack_is_empty(S)) {
+        const Node *node_2 = stack_pop(S),
+                   *node_1 = stack_pop(S);
+
+        if (node_is_leaf(*node_1) != node_is_leaf(*node_2)) {
+            is_equal = 0;
+        }
+        else if (node_is_leaf(*node_1)) {
+            is_equal = node_1->labels == node_2->labels;
+        }
+        else if (node_1->feature != node_2->feature || node_1->threshold != node_2->threshold) {
+            is_equal = 0;
+        }
+        else {
+            stack_push(S, node_1->right);
+            stack_push(S, node_2->right);
+            stack_push(S, node_1->left);
+            stack_push(S, node_2->left);
+        }
+    }
+    stack_delete(&S);
+
+    return is_equal;
+}
+
+
+
 void decision_tree_leaves(Node *leaves, const DecisionTree tree) {
     node_reachable_leaves(leaves, *tree.root);
 }
@@ -121,8 +342,10 @@ void decision_tree_leaves(Node *leaves, const DecisionTree tree) {
 Bitmask decision_tree_classify(const DecisionTree tree, const double *point) {
     Node *node = tree.root;
 
+    counter_add(COUNTER_CLASSIFIED_SAMPLES, 1);
     while (!node_is_leaf(*node)) {
         node = point[node->feature] <= node->threshold ? node->left : node->right;
+        counter_add(COUNTER_CLASSIFY_NODES, 1);
     }
 
     return node->labels;
@@ -131,13 +354,27 @@ Bitmask decision_tree_classify(const DecisionTree tree, const double *point) {
 
 
 double decision_tree_similarity(const DecisionTree tree_1, const DecisionTree tree_2, const Dataset dataset) {
-    unsigned int i, n_matches = 0;
+    Bitmask labels_1[SIMILARITY_BLOCK_SIZE], labels_2[SIMILARITY_BLOCK_SIZE];
+    unsigned int i, j, n_matches = 0;
+    FlatTree flat_1, flat_2;
 
-    for (i = 0; i < dataset.size; ++i) {
-        const double *point = dataset.points + i * dataset.space_size;
-        n_matches += decision_tree_classify(tree_1, point) == decision_tree_classify(tree_2, point);
+    flat_tree_create(&flat_1, tree_1);
+    flat_tree_create(&flat_2, tree_2);
+
+    for (i = 0; i < dataset.size; i += SIMILARITY_BLOCK_SIZE) {
+        const unsigned int n = i + SIMILARITY_BLOCK_SIZE < dataset.size ? SIMILARITY_BLOCK_SIZE : dataset.size - i;
+        const double *points = dataset.points + i * dataset.space_size;
+
+        flat_tree_classify_batch(labels_1, flat_1, points, dataset.space_size, NULL, n);
+        flat_tree_classify_batch(labels_2, flat_2, points, dataset.space_size, NULL, n);
+        for (j = 0; j < n; ++j) {
+            n_matches += labels_1[j] == labels_2[j];
+        }
     }
 
+    flat_tree_delete(flat_1);
+    flat_tree_delete(flat_2);
+
     return (double) n_matches / dataset.size;
 }
 
@@ -282,16 +519,51 @@ unsigned int node_depth(const Node node) {
 
 void node_prune(Node *node) {
     if (node->left) {
-        node_delete(node->left);
+        node_delete(node->left, node->tree->pool);
         node->left = NULL;
     }
     if (node->right) {
-        node_delete(node->right);
+        node_delete(node->right, node->tree->pool);
         node->right = NULL;
     }
 }
 
 
+void node_attach(Node *node, const unsigned int feature, const double threshold) {
+    /* Children own no samples, frequencies are set by the caller */
+    node->feature = feature;
+    node->threshold = threshold;
+    node->left = node_alloc(node->tree);
+    node->right = node_alloc(node->tree);
+    node_create(node->left, node->tree, node);
+    node_create(node->right, node->tree, node);
+}
+
+
+
+void node_set_frequencies(Node *node, const unsigned int *frequencies) {
+    const unsigned int n_labels = node->tree->dataset.n_labels;
+    unsigned int i, n = 0, max = 0;
+
+    for (i = 0; i < n_labels; ++i) {
+        node->frequencies[i] = frequencies[i];
+        n += frequencies[i];
+        if (frequencies[i] > max) {
+            max = frequencies[i];
+        }
+    }
+
+    node->labels = BITMASK_NOTHING;
+    for (i = 0; i < n_labels; ++i) {
+        node->probabilities[i] = n > 0 ? (double) frequencies[i] / n : 0.0;
+        if (frequencies[i] == max) {
+            bitmask_set(node->labels, i);
+        }
+    }
+}
+
+
+
 SplitResult node_split(
     Node *node,
     const unsigned int feature,
@@ -300,32 +572,35 @@ SplitResult node_split(
     const unsigned int space_size = node->tree->dataset.space_size;
     const unsigned int *label_lookup = node->tree->dataset.label_lookup;
     const double *samples = node->tree->dataset.points;
-    double **samples_lookup = node->tree->samples;
+    const Partition samples_lookup = node->tree->samples;
     unsigned int i, j, max_left = 0, max_right = 0;
     Node *left, *right;
 
-    left = (Node *) malloc(sizeof(Node));
-    right = (Node *) malloc(sizeof(Node));
+    left = node_alloc(node->tree);
+    right = node_alloc(node->tree);
     node_create(left, node->tree, node);
     node_create(right, node->tree, node);
+    partition_detach(samples_lookup, node->first_sample_idx, node->last_sample_idx);
+    counter_add(COUNTER_NODE_SPLITS, 1);
+    counter_add(COUNTER_NODE_SPLIT_SAMPLES, node->last_sample_idx - node->first_sample_idx + 1);
 
     j = node->last_sample_idx;
     for (i = node->first_sample_idx; i <= j; ++i) {
-        const double *sample_i = samples_lookup[i];
-        const unsigned int label_i = label_lookup[(sample_i - samples) / space_size];
-        double *sample_j = samples_lookup[j];
-        unsigned int label_j = label_lookup[(sample_j - samples) / space_size];
+        const uint32_t sample_i = partition_get(samples_lookup, i);
+        const unsigned int label_i = label_lookup[sample_i];
+        uint32_t sample_j = partition_get(samples_lookup, j);
+        unsigned int label_j = label_lookup[sample_j];
 
-        if (sample_i[feature] <= threshold) {
+        if (samples[sample_i * space_size + feature] <= threshold) {
             ++left->frequencies[label_i];
             continue;
         }
 
         for (; j > i; --j) {
-            sample_j = (double *) samples_lookup[j];
-            label_j = label_lookup[(sample_j - samples) / space_size];
+            sample_j = partition_get(samples_lookup, j);
+            label_j = label_lookup[sample_j];
 
-            if (sample_j[feature] <= threshold) {
+            if (samples[sample_j * space_size + feature] <= threshold) {
                 break;
             }
 
@@ -340,15 +615,17 @@ SplitResult node_split(
         else {
             ++left->frequencies[label_j];
             ++right->frequencies[label_i];
-            samples_lookup[i] = sample_j;
-            samples_lookup[j] = (double *) sample_i;
+            partition_set(samples_lookup, i, sample_j);
+            partition_set(samples_lookup, j, sample_i);
+            counter_add(COUNTER_NODE_SPLIT_MOVES, 2);
             --j;
         }
     }
 
-    if (node->first_sample_idx >= j || j == node->last_sample_idx) {
-        node_delete(left);
-        node_delete(right);
+    /* j wraps around when every sample of the first node goes right */
+    if (j + 1 <= node->first_sample_idx + 1 || j == node->last_sample_idx) {
+        node_delete(left, node->tree->pool);
+        node_delete(right, node->tree->pool);
 
         return node->last_sample_idx == j ? SPLIT_LEFT : SPLIT_RIGHT;
     }
@@ -5,6 +5,8 @@
 
 #include "../data/dataset.h"
 #include "../data_structures/bitmask.h"
+#include "partition.h"
+#include "pool.h"
 
 
 typedef struct decision_tree DecisionTree;
@@ -13,7 +15,8 @@ typedef struct node Node;
 struct decision_tree {
     Node *root;
     Dataset dataset;
-    double **samples;
+    Partition samples;
+    TreePool *pool;
 };
 
 struct node {
@@ -42,12 +45,22 @@ typedef enum split_result SplitResult;
 
 void decision_tree_create(DecisionTree *tree, const Dataset dataset);
 
+void decision_tree_copy(DecisionTree *copy, const DecisionTree tree, TreePool *pool);
+
 void decision_tree_delete(DecisionTree tree);
 
+void decision_tree_partition(DecisionTree *tree, const Dataset dataset);
+
+void decision_tree_grow_random(DecisionTree *tree, const Dataset dataset, const unsigned int depth);
+
 unsigned int decision_tree_n_nodes(const DecisionTree tree);
 
 unsigned int decision_tree_n_leaves(const DecisionTree tree);
 
+unsigned long decision_tree_fingerprint(const DecisionTree tree);
+
+unsigned int decision_tree_is_equal(const DecisionTree tree_1, const DecisionTree tree_2);
+
 void decision_tree_leaves(Node *leaves, const DecisionTree tree);
 
 Bitmask decision_tree_classify(const DecisionTree tree, const double *point);
@@ -78,6 +91,10 @@ void node_prune(Node *node);
 
 SplitResult node_split(Node *node, const unsigned int feature, const double threshold);
 
+void node_attach(Node *node, const unsigned int feature, const double threshold);
+
+void node_set_frequencies(Node *node, const unsigned int *frequencies);
+
 
 void decision_tree_print(FILE *fh, DecisionTree tree);
 
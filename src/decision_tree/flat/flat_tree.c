@@ -0,0 +1,407 @@
+#define _XOPEN_SOURCE 500
+
+#include "flat_tree.h"
+
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+
+#include "../../data_structures/counters.h"
+#include "../../data_structures/stack.h"
+
+/* Doublings of the step bracketing least epsilon, enough to span every
+ * finite double */
+#define LEAST_EPSILON_MAX_STEPS 2100
+
+
+/***********************************************************************
+ * Internal functions.
+ **********************************************************************/
+
+static void classify_lanes(
+    Bitmask *labels,
+    const FlatTree tree,
+    const double *points,
+    const unsigned int space_size,
+    const unsigned int *sample,
+    const unsigned int first
+) {
+    unsigned int node[FLAT_TREE_LANES], d, l;
+    const double *point[FLAT_TREE_LANES];
+
+    counter_add(COUNTER_CLASSIFIED_SAMPLES, FLAT_TREE_LANES);
+    for (l = 0; l < FLAT_TREE_LANES; ++l) {
+        node[l] = 0;
+        point[l] = points + (sample ? sample[first + l] : first + l) * space_size;
+    }
+
+    /* Lanes are independent, every step is a load and a masked select
+     * (a conditional expression would be compiled into a branch); leaves
+     * always select their right child, which is themselves, whatever the
+     * value of the point */
+    for (d = 0; d < tree.depth; ++d) {
+        unsigned int moved = 0;
+
+        for (l = 0; l < FLAT_TREE_LANES; ++l) {
+            const FlatNode *current = tree.nodes + node[l];
+            const unsigned int mask = -(unsigned int) (!(point[l][current->feature] <= current->threshold)
+                                                       | (current->right == node[l])),
+                               left = node[l] + 1,
+                               next = left ^ (mask & (left ^ current->right));
+
+            counter_add(COUNTER_CLASSIFY_NODES, next != node[l]);
+            moved |= next ^ node[l];
+            node[l] = next;
+        }
+
+        if (!moved) {
+            break;
+        }
+    }
+
+    for (l = 0; l < FLAT_TREE_LANES; ++l) {
+        labels[first + l] = tree.labels[node[l]];
+    }
+}
+
+
+
+static unsigned int box_reaches(const double x, const double threshold, const double epsilon, const unsigned int is_right) {
+    return is_right ? x + epsilon > threshold : x - epsilon <= threshold;
+}
+
+
+
+static double least_epsilon(const double x, const double threshold, const unsigned int is_right) {
+    double low, high = is_right ? threshold - x : x - threshold, step;
+    unsigned int i;
+
+    if (box_reaches(x, threshold, 0.0, is_right)) {
+        return 0.0;
+    }
+
+    /* Infinite or NaN values compare the same way for every finite
+     * epsilon, so a side not reached at 0 is never reached; their
+     * difference is infinite or NaN too */
+    if (!(high - high == 0.0)) {
+        return HUGE_VAL;
+    }
+
+    /* Smallest epsilon for which the box reaches the side, under the very
+     * comparisons used by stability checks: distance is a guess off by a
+     * rounding error at most, bracketed then refined by bisection */
+    step = (fabs(x) > fabs(threshold) ? fabs(x) : fabs(threshold)) * DBL_EPSILON + DBL_MIN;
+    low = 0.0;
+    for (i = 0; !box_reaches(x, threshold, high, is_right); ++i) {
+        if (i == LEAST_EPSILON_MAX_STEPS) {
+            return HUGE_VAL;
+        }
+        low = high;
+        high += step;
+        step *= 2.0;
+    }
+    if (low == 0.0 && high > 0.0 && !box_reaches(x, threshold, nextafter(high, 0.0), is_right)) {
+        return high;
+    }
+
+    while (1) {
+        const double middle = low + (high - low) / 2.0;
+
+        if (middle <= low || middle >= high) {
+            break;
+        }
+        if (box_reaches(x, threshold, middle, is_right)) {
+            high = middle;
+        }
+        else {
+            low = middle;
+        }
+    }
+
+    return high;
+}
+
+
+
+/***********************************************************************
+ * Public functions.
+ **********************************************************************/
+
+void flat_tree_create(FlatTree *flat_tree, const DecisionTree tree) {
+    const unsigned int n_nodes = decision_tree_n_nodes(tree);
+    Node **nodes = (Node **) malloc(n_nodes * sizeof(Node *));
+    unsigned int *depths = (unsigned int *) malloc(n_nodes * sizeof(unsigned int));
+    unsigned char *is_used = (unsigned char *) calloc(tree.dataset.space_size, sizeof(unsigned char));
+    unsigned int i, n = 0;
+    Stack S;
+
+    flat_tree->n_nodes = n_nodes;
+    flat_tree->depth = 0;
+    flat_tree->nodes = (FlatNode *) malloc(n_nodes * sizeof(FlatNode));
+    flat_tree->ends = (unsigned int *) malloc(n_nodes * sizeof(unsigned int));
+    flat_tree->labels = (Bitmask *) malloc(n_nodes * sizeof(Bitmask));
+    flat_tree->features = (unsigned int *) malloc(tree.dataset.space_size * sizeof(unsigned int));
+    flat_tree->n_features = 0;
+    flat_tree->reached = (Bitmask *) malloc(n_nodes * sizeof(Bitmask));
+
+    /* Lists nodes in preorder */
+    stack_create(&S);
+    stack_push(S, tree.root);
+    while (!stack_is_empty(S)) {
+        Node *node = stack_pop(S);
+
+        nodes[n++] = node;
+        if (!node_is_leaf(*node)) {
+            stack_push(S, node->right);
+            stack_push(S, node->left);
+        }
+    }
+    stack_delete(&S);
+
+    /* Right child follows the subtree of left child */
+    for (i = n_nodes; i > 0; --i) {
+        const unsigned int j = i - 1;
+        const Node *node = nodes[j];
+
+        flat_tree->labels[j] = node->labels;
+        if (node_is_leaf(*node)) {
+            flat_tree->nodes[j].threshold = -HUGE_VAL;
+            flat_tree->nodes[j].feature = 0;
+            flat_tree->nodes[j].right = j;
+            flat_tree->ends[j] = j + 1;
+        }
+        else {
+            flat_tree->nodes[j].threshold = node->threshold;
+            flat_tree->nodes[j].feature = node->feature;
+            flat_tree->nodes[j].right = flat_tree->ends[j + 1];
+            flat_tree->ends[j] = flat_tree->ends[flat_tree->ends[j + 1]];
+            if (!is_used[node->feature]) {
+                is_used[node->feature] = 1;
+                flat_tree->features[flat_tree->n_features++] = node->feature;
+            }
+        }
+    }
+
+    /* Depth bounds the number of traversal steps */
+    depths[0] = 0;
+    for (i = 0; i < n_nodes; ++i) {
+        if (!flat_tree_is_leaf(*flat_tree, i)) {
+            depths[i + 1] = depths[i] + 1;
+            depths[flat_tree->nodes[i].right] = depths[i] + 1;
+        }
+        else if (depths[i] > flat_tree->depth) {
+            flat_tree->depth = depths[i];
+        }
+    }
+
+    free(nodes);
+    free(depths);
+    free(is_used);
+}
+
+
+
+void flat_tree_delete(FlatTree flat_tree) {
+    free(flat_tree.nodes);
+    free(flat_tree.ends);
+    free(flat_tree.labels);
+    free(flat_tree.features);
+    free(flat_tree.reached);
+}
+
+
+
+Bitmask flat_tree_classify(const FlatTree tree, const double *point) {
+    unsigned int i = 0;
+
+    counter_add(COUNTER_CLASSIFIED_SAMPLES, 1);
+    while (!flat_tree_is_leaf(tree, i)) {
+        const FlatNode node = tree.nodes[i];
+        i = point[node.feature] <= node.threshold ? i + 1 : node.right;
+        counter_add(COUNTER_CLASSIFY_NODES, 1);
+    }
+
+    return tree.labels[i];
+}
+
+
+
+void flat_tree_classify_batch(
+    Bitmask *labels,
+    const FlatTree tree,
+    const double *points,
+    const unsigned int space_size,
+    const unsigned int *sample,
+    const unsigned int n
+) {
+    unsigned int i;
+
+    for (i = 0; i + FLAT_TREE_LANES <= n; i += FLAT_TREE_LANES) {
+        classify_lanes(labels, tree, points, space_size, sample, i);
+    }
+
+    for (; i < n; ++i) {
+        labels[i] = flat_tree_classify(tree, points + (sample ? sample[i] : i) * space_size);
+    }
+}
+
+
+
+Bitmask flat_tree_stable_batch(
+    const FlatTree tree,
+    const double *points,
+    const unsigned int space_size,
+    const unsigned int *sample,
+    const unsigned int n,
+    const Bitmask *labels,
+    const double *epsilons,
+    const Hyperrectangle *boxes,
+    double *columns
+) {
+    const Bitmask all = n < FLAT_TREE_BLOCK_SIZE ? (1UL << n) - 1 : BITMASK_ALL;
+    Bitmask unstable = BITMASK_NOTHING;
+    unsigned int i, s;
+
+    if (n == 0) {
+        return BITMASK_NOTHING;
+    }
+    counter_add(COUNTER_STABILITY_SAMPLES, n);
+
+    /* Lays out bounds of used features by column, either from the boxes
+     * or around samples, padding with the last sample */
+    for (i = 0; i < tree.n_features; ++i) {
+        const unsigned int feature = tree.features[i];
+        double *lower = columns + 2 * feature * FLAT_TREE_BLOCK_SIZE,
+               *upper = lower + FLAT_TREE_BLOCK_SIZE;
+
+        for (s = 0; s < FLAT_TREE_BLOCK_SIZE; ++s) {
+            const unsigned int j = sample ? sample[s < n ? s : n - 1] : (s < n ? s : n - 1);
+
+            if (boxes) {
+                lower[s] = boxes[j].lowerbounds[feature];
+                upper[s] = boxes[j].upperbounds[feature];
+            }
+            else {
+                lower[s] = points[j * space_size + feature] - epsilons[feature];
+                upper[s] = points[j * space_size + feature] + epsilons[feature];
+            }
+        }
+    }
+
+    /* Pushes the set of samples whose box reaches a node down the tree
+     * in preorder, skipping subtrees no box reaches */
+    tree.reached[0] = all;
+    i = 0;
+    while (i < tree.n_nodes) {
+        const Bitmask reached = bitmask_difference(tree.reached[i], unstable);
+
+        if (reached == BITMASK_NOTHING) {
+            i = tree.ends[i];
+            continue;
+        }
+
+        if (flat_tree_is_leaf(tree, i)) {
+            Bitmask agree = BITMASK_NOTHING;
+
+            for (s = 0; s < n; ++s) {
+                agree |= (Bitmask) (labels[s] == tree.labels[i]) << s;
+            }
+            unstable |= bitmask_difference(reached, agree);
+        }
+        else {
+            const double *lower = columns + 2 * tree.nodes[i].feature * FLAT_TREE_BLOCK_SIZE,
+                         *upper = lower + FLAT_TREE_BLOCK_SIZE;
+            const double threshold = tree.nodes[i].threshold;
+            Bitmask left = BITMASK_NOTHING, right = BITMASK_NOTHING;
+
+            for (s = 0; s < FLAT_TREE_BLOCK_SIZE; ++s) {
+                left |= (Bitmask) (lower[s] <= threshold) << s;
+                right |= (Bitmask) (upper[s] > threshold) << s;
+            }
+            tree.reached[i + 1] = reached & left;
+            tree.reached[tree.nodes[i].right] = reached & right;
+            counter_add(COUNTER_STABILITY_PUSHES, 2);
+        }
+
+        ++i;
+    }
+
+    return bitmask_difference(all, unstable);
+}
+
+
+
+void flat_tree_stability_radii(
+    double *radii,
+    const FlatTree tree,
+    const double *points,
+    const unsigned int space_size,
+    const unsigned int *sample,
+    const unsigned int n
+) {
+    unsigned char *is_uniform = (unsigned char *) malloc(tree.n_nodes * sizeof(unsigned char));
+    Bitmask *uniform = (Bitmask *) malloc(tree.n_nodes * sizeof(Bitmask));
+    unsigned int *stack_nodes = (unsigned int *) malloc((tree.depth + 2) * sizeof(unsigned int));
+    double *stack_epsilons = (double *) malloc((tree.depth + 2) * sizeof(double));
+    unsigned int i, s;
+
+    /* Marks subtrees whose leaves all share the same labels */
+    for (i = tree.n_nodes; i > 0; --i) {
+        const unsigned int j = i - 1;
+
+        uniform[j] = tree.labels[j];
+        is_uniform[j] = 1;
+        if (!flat_tree_is_leaf(tree, j)) {
+            const unsigned int left = j + 1, right = tree.nodes[j].right;
+
+            uniform[j] = uniform[left];
+            is_uniform[j] = is_uniform[left] && is_uniform[right] && uniform[left] == uniform[right];
+        }
+    }
+
+    /* Branch and bound: looks for the reachable leaf with different
+     * labels needing the smallest epsilon, nearest side first */
+    for (s = 0; s < n; ++s) {
+        const double *point = points + (sample ? sample[s] : s) * space_size;
+        const Bitmask labels = flat_tree_classify(tree, point);
+        double radius = HUGE_VAL;
+        unsigned int top = 0;
+
+        counter_add(COUNTER_STABILITY_SAMPLES, 1);
+        counter_add(COUNTER_STABILITY_PUSHES, 1);
+        stack_nodes[top] = 0;
+        stack_epsilons[top++] = 0.0;
+        while (top > 0) {
+            const unsigned int j = stack_nodes[--top];
+            const double epsilon = stack_epsilons[top];
+
+            if (epsilon >= radius || (is_uniform[j] && uniform[j] == labels)) {
+                continue;
+            }
+
+            if (flat_tree_is_leaf(tree, j)) {
+                radius = epsilon;
+            }
+            else {
+                const double x = point[tree.nodes[j].feature],
+                             threshold = tree.nodes[j].threshold,
+                             left = least_epsilon(x, threshold, 0),
+                             right = least_epsilon(x, threshold, 1);
+                const unsigned int is_left_nearer = left <= right;
+
+                stack_nodes[top] = is_left_nearer ? tree.nodes[j].right : j + 1;
+                stack_epsilons[top++] = is_left_nearer ? (right > epsilon ? right : epsilon) : (left > epsilon ? left : epsilon);
+                stack_nodes[top] = is_left_nearer ? j + 1 : tree.nodes[j].right;
+                stack_epsilons[top++] = is_left_nearer ? (left > epsilon ? left : epsilon) : (right > epsilon ? right : epsilon);
+                counter_add(COUNTER_STABILITY_PUSHES, 2);
+            }
+        }
+
+        radii[s] = radius;
+    }
+
+    free(is_uniform);
+    free(uniform);
+    free(stack_nodes);
+    free(stack_epsilons);
+}
@@ -0,0 +1,81 @@
+#ifndef DECISION_TREE_FLAT_FLAT_TREE_H
+#define DECISION_TREE_FLAT_FLAT_TREE_H
+
+#include "../decision_tree.h"
+#include "../../geometry/hyperrectangle.h"
+
+#define FLAT_TREE_LANES 4
+#define FLAT_TREE_BLOCK_SIZE BITMASK_SIZE
+
+
+typedef struct flat_node FlatNode;
+typedef struct flat_tree FlatTree;
+
+/* Node of a flat tree. Left child of node i is node i + 1, right child
+ * is node right; a point goes right unless its feature is at most the
+ * threshold. Leaves are their own right child, so that traversal can go
+ * on for a fixed number of steps without branching on node type. */
+struct flat_node {
+    double threshold;
+    unsigned int feature;
+    unsigned int right;
+};
+
+
+/* Decision tree stored as an array of nodes in preorder. Subtree rooted
+ * at node i spans nodes from i to ends[i] excluded. Features lists the
+ * distinct features used by splits, reached is scratch space for batched
+ * stability checks. */
+struct flat_tree {
+    unsigned int n_nodes;
+    unsigned int depth;
+    FlatNode *nodes;
+    unsigned int *ends;
+    Bitmask *labels;
+    unsigned int *features;
+    unsigned int n_features;
+    Bitmask *reached;
+};
+
+
+#define flat_tree_is_leaf(tree, i) \
+    ((tree).nodes[i].right == (i))
+
+
+void flat_tree_create(FlatTree *flat_tree, const DecisionTree tree);
+
+void flat_tree_delete(FlatTree flat_tree);
+
+Bitmask flat_tree_classify(const FlatTree tree, const double *point);
+
+void flat_tree_classify_batch(
+    Bitmask *labels,
+    const FlatTree tree,
+    const double *points,
+    const unsigned int space_size,
+    const unsigned int *sample,
+    const unsigned int n
+);
+
+Bitmask flat_tree_stable_batch(
+    const FlatTree tree,
+    const double *points,
+    const unsigned int space_size,
+    const unsigned int *sample,
+    const unsigned int n,
+    const Bitmask *labels,
+    const double *epsilons,
+    const Hyperrectangle *boxes,
+    double *columns
+);
+
+void flat_tree_stability_radii(
+    double *radii,
+    const FlatTree tree,
+    const double *points,
+    const unsigned int space_size,
+    const unsigned int *sample,
+    const unsigned int n
+);
+
+#endif
@@ -0,0 +1,126 @@
+#include "binary.h"
+
+#include <stdlib.h>
+
+#include "../../data_structures/stack.h"
+
+
+/***********************************************************************
+ * Internal functions.
+ **********************************************************************/
+
+static void read_or_abort(void *data, const size_t size, const size_t n, FILE *fh) {
+    if (fread(data, size, n, fh) != n) {
+        fprintf(stderr, "[%s: %d] Cannot read decision tree.\n", __FILE__, __LINE__);
+        abort();
+    }
+}
+
+
+
+static void write_or_abort(const void *data, const size_t size, const size_t n, FILE *fh) {
+    if (fwrite(data, size, n, fh) != n) {
+        fprintf(stderr, "[%s: %d] Cannot write decision tree.\n", __FILE__, __LINE__);
+        abort();
+    }
+}
+
+
+
+/***********************************************************************
+ * Public functions.
+ **********************************************************************/
+
+void decision_tree_mapper_binary_load(FILE *fh, DecisionTree *tree, const Dataset dataset) {
+    unsigned int i, header[2];
+    Stack S;
+
+    read_or_abort(header, sizeof(unsigned int), 2, fh);
+    if (header[0] != dataset.size || header[1] != dataset.n_labels) {
+        fprintf(stderr, "[%s: %d] Decision tree does not match dataset.\n", __FILE__, __LINE__);
+        abort();
+    }
+
+    /* Rebuilds structure by splitting, then restores node statistics */
+    decision_tree_create(tree, dataset);
+    stack_create(&S);
+    stack_push(S, tree->root);
+    while (!stack_is_empty(S)) {
+        Node *node = stack_pop(S);
+        unsigned char is_leaf;
+
+        read_or_abort(&is_leaf, sizeof(is_leaf), 1, fh);
+        read_or_abort(&node->feature, sizeof(node->feature), 1, fh);
+        read_or_abort(&node->threshold, sizeof(node->threshold), 1, fh);
+        if (!is_leaf) {
+            if (node->feature >= dataset.space_size) {
+                fprintf(stderr, "[%s: %d] Decision tree splits on feature %u, dataset has %u.\n", __FILE__, __LINE__, node->feature, dataset.space_size);
+                abort();
+            }
+            if (node_split(node, node->feature, node->threshold) != SPLIT_BOTH) {
+                fprintf(stderr, "[%s: %d] Decision tree does not match dataset.\n", __FILE__, __LINE__);
+                abort();
+            }
+            stack_push(S, node->right);
+            stack_push(S, node->left);
+        }
+        read_or_abort(&node->labels, sizeof(node->labels), 1, fh);
+        read_or_abort(&node->first_sample_idx, sizeof(node->first_sample_idx), 1, fh);
+        read_or_abort(&node->last_sample_idx, sizeof(node->last_sample_idx), 1, fh);
+        if (node->first_sample_idx > node->last_sample_idx || node->last_sample_idx >= (dataset.size > 0 ? dataset.size : 1)) {
+            fprintf(stderr, "[%s: %d] Decision tree holds samples out of range.\n", __FILE__, __LINE__);
+            abort();
+        }
+        read_or_abort(node->frequencies, sizeof(unsigned int), dataset.n_labels, fh);
+        read_or_abort(node->probabilities, sizeof(double), dataset.n_labels, fh);
+    }
+    stack_delete(&S);
+
+    /* Restores sample order, which later splits depend on */
+    for (i = 0; i < dataset.size; ++i) {
+        uint32_t sample;
+        read_or_abort(&sample, sizeof(sample), 1, fh);
+        if (sample >= dataset.size) {
+            fprintf(stderr, "[%s: %d] Decision tree holds samples out of range.\n", __FILE__, __LINE__);
+            abort();
+        }
+        partition_set(tree->samples, i, sample);
+    }
+}
+
+
+
+void decision_tree_mapper_binary_save(FILE *fh, const DecisionTree tree) {
+    unsigned int i, header[2];
+    Stack S;
+
+    header[0] = tree.dataset.size;
+    header[1] = tree.dataset.n_labels;
+    write_or_abort(header, sizeof(unsigned int), 2, fh);
+
+    stack_create(&S);
+    stack_push(S, tree.root);
+    while (!stack_is_empty(S)) {
+        const Node *node = stack_pop(S);
+        const unsigned char is_leaf = node_is_leaf(*node);
+
+        write_or_abort(&is_leaf, sizeof(is_leaf), 1, fh);
+        write_or_abort(&node->feature, sizeof(node->feature), 1, fh);
+        write_or_abort(&node->threshold, sizeof(node->threshold), 1, fh);
+        write_or_abort(&node->labels, sizeof(node->labels), 1, fh);
+        write_or_abort(&node->first_sample_idx, sizeof(node->first_sample_idx), 1, fh);
+        write_or_abort(&node->last_sample_idx, sizeof(node->last_sample_idx), 1, fh);
+        write_or_abort(node->frequencies, sizeof(unsigned int), tree.dataset.n_labels, fh);
+        write_or_abort(node->probabilities, sizeof(double), tree.dataset.n_labels, fh);
+        if (!is_leaf) {
+            stack_push(S, node->right);
+            stack_push(S, node->left);
+        }
+    }
+    stack_delete(&S);
+
+    for (i = 0; i < tree.dataset.size; ++i) {
+        const uint32_t sample = partition_get(tree.samples, i);
+        write_or_abort(&sample, sizeof(sample), 1, fh);
+    }
+}
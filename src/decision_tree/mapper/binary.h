@@ -0,0 +1,17 @@
+#ifndef DECISION_TREE_MAPPER_BINARY_H
+#define DECISION_TREE_MAPPER_BINARY_H
+
+#include <stdio.h>
+
+#include "../decision_tree.h"
+
+/* Native-endian dump of a tree, including node statistics and sample
+ * partition, so that a loaded tree is indistinguishable from the saved
+ * one. Only meant to be read back on the same machine with the same
+ * dataset. */
+
+void decision_tree_mapper_binary_load(FILE *fh, DecisionTree *tree, const Dataset dataset);
+
+void decision_tree_mapper_binary_save(FILE *fh, const DecisionTree tree);
+
+#endif
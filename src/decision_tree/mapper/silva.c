@@ -1,215 +1,311 @@
 #include "silva.h"
 
+#include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include "../../data/text.h"
 #include "../../data_structures/stack.h"
 
 
-#define BUFFER_SIZE 32
+#define BUFFER_SIZE 64
+#define MAX_FAST_DIGITS 15
+#define MAX_FAST_EXPONENT 22
 
 /***********************************************************************
  * Internal functions.
  **********************************************************************/
 
-static void parse_node(Node *node, FILE *fh);
+/* Tokens are pointers into the text, nothing is copied but labels */
+struct parser {
+    const char *cursor;
+    const char *end;
+};
 
-static void skip_node(const unsigned int n_labels, FILE *fh);
 
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
 
-static void parse_split(Node *node, FILE *fh) {
-    unsigned int n, feature;
-    double threshold;
-    SplitResult split_result;
 
-    n = fscanf(fh, "%u %lf", &feature, &threshold);
-    if (n != 2) {
-        fprintf(stderr, "[%s: %d] Cannot parse decision tree node.\n", __FILE__, __LINE__);
-        abort();
-    }
 
-    split_result = node_split(node, feature, threshold);
-    switch (split_result) {
-        case SPLIT_BOTH:
-            parse_node(node->left, fh);
-            parse_node(node->right, fh);
-            break;
-        case SPLIT_LEFT:
-            parse_node(node, fh);
-            skip_node(node->tree->dataset.n_labels, fh);
-            break;
-        case SPLIT_RIGHT:
-            skip_node(node->tree->dataset.n_labels, fh);
-            parse_node(node, fh);
-            break;
+static unsigned int is_space(const char c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+
+
+static const char *skip_spaces(const char *cursor, const char *end) {
+    while (cursor < end && is_space(*cursor)) {
+        ++cursor;
     }
+
+    return cursor;
 }
 
 
 
-static void parse_leaf(Node *node, FILE *fh) {
-    const unsigned int n_labels = node->tree->dataset.n_labels;
-    unsigned int i, n, n_samples;
+static const char *next_token(struct parser *parser, unsigned int *length) {
+    const char *token = skip_spaces(parser->cursor, parser->end);
 
-    for (i = 0; i < n_labels; ++i) {
-        n = fscanf(fh, "%u", &n_samples);
-        if (n != 1) {
-            fprintf(stderr, "[%s: %d] Parse error.\n", __FILE__, __LINE__);
-        }
+    if (token == parser->end) {
+        fprintf(stderr, "[%s: %d] Unexpected end of decision tree.\n", __FILE__, __LINE__);
+        abort();
     }
+
+    parser->cursor = token;
+    while (parser->cursor < parser->end && !is_space(*parser->cursor)) {
+        ++parser->cursor;
+    }
+    *length = parser->cursor - token;
+
+    return token;
 }
 
 
 
-static void parse_logarithmic_leaf(Node *node, FILE *fh) {
-    const unsigned int n_labels = node->tree->dataset.n_labels;
-    unsigned int i, n;
-    float value;
+static unsigned int is_token(const char *token, const unsigned int length, const char *word) {
+    return length == strlen(word) && memcmp(token, word, length) == 0;
+}
 
-    for (i = 0; i < n_labels; ++i) {
-        n = fscanf(fh, "%g", &value);
-        if (n != 1) {
-            fprintf(stderr, "[%s: %d] Parse error.\n", __FILE__, __LINE__);
+
+
+static unsigned int parse_unsigned(struct parser *parser) {
+    unsigned int length, i;
+    const char *token = next_token(parser, &length);
+    unsigned long value = 0;
+
+    for (i = 0; i < length; ++i) {
+        if (token[i] < '0' || token[i] > '9' || value > UINT_MAX) {
+            fprintf(stderr, "[%s: %d] Cannot parse integer \"%.*s\".\n", __FILE__, __LINE__, (int) length, token);
+            abort();
         }
+        value = 10 * value + (token[i] - '0');
+    }
+    if (length == 0 || value > UINT_MAX) {
+        fprintf(stderr, "[%s: %d] Cannot parse integer \"%.*s\".\n", __FILE__, __LINE__, (int) length, token);
+        abort();
     }
+
+    return value;
 }
 
 
 
-static void parse_node(Node *node, FILE *fh) {
-    unsigned int n;
-    char node_type[BUFFER_SIZE];
+/* Numbers with few digits and small exponents are exact as mantissa
+ * and power of ten, so one operation rounds them as strtod does */
+static double parse_double(struct parser *parser) {
+    unsigned int length, i = 0, n_digits = 0, n_significant_digits = 0, n_exponent_digits = 0,
+                 is_negative = 0, is_exponent_negative = 0, has_exponent = 0;
+    const char *token = next_token(parser, &length);
+    unsigned long mantissa = 0;
+    long exponent = 0, written_exponent = 0;
+    char buffer[BUFFER_SIZE], *number_end;
+    double value;
 
-    n = fscanf(fh, "%s", node_type);
-    if (n != 1) {
-        fprintf(stderr, "[%s: %d] Cannot parse decision tree node.\n", __FILE__, __LINE__);
-        abort();
+    if (i < length && (token[i] == '-' || token[i] == '+')) {
+        is_negative = token[i] == '-';
+        ++i;
     }
-
-    if (strcmp(node_type, "LEAF") == 0) {
-        parse_leaf(node, fh);
+    for (; i < length && token[i] >= '0' && token[i] <= '9'; ++i, ++n_digits) {
+        if (mantissa > 0 || token[i] != '0') {
+            mantissa = 10 * mantissa + (token[i] - '0');
+            ++n_significant_digits;
+        }
     }
-
-    else if (strcmp(node_type, "LEAF_LOGARITHMIC") == 0) {
-        parse_logarithmic_leaf(node, fh);
+    if (i < length && token[i] == '.') {
+        for (++i; i < length && token[i] >= '0' && token[i] <= '9'; ++i, ++n_digits) {
+            if (mantissa > 0 || token[i] != '0') {
+                mantissa = 10 * mantissa + (token[i] - '0');
+                ++n_significant_digits;
+            }
+            --exponent;
+        }
+    }
+    if (i < length && (token[i] == 'e' || token[i] == 'E')) {
+        has_exponent = 1;
+        ++i;
+        if (i < length && (token[i] == '-' || token[i] == '+')) {
+            is_exponent_negative = token[i] == '-';
+            ++i;
+        }
+        for (; i < length && token[i] >= '0' && token[i] <= '9'; ++i, ++n_exponent_digits) {
+            if (written_exponent < 10 * MAX_FAST_EXPONENT) {
+                written_exponent = 10 * written_exponent + (token[i] - '0');
+            }
+        }
+        exponent += is_exponent_negative ? -written_exponent : written_exponent;
     }
 
-    else if (strcmp(node_type, "SPLIT") == 0) {
-        parse_split(node, fh);
+    if (i == length && n_digits > 0 && (!has_exponent || n_exponent_digits > 0)
+        && n_significant_digits <= MAX_FAST_DIGITS
+        && exponent >= -MAX_FAST_EXPONENT && exponent <= MAX_FAST_EXPONENT) {
+        value = exponent < 0 ? mantissa / powers_of_ten[-exponent] : mantissa * powers_of_ten[exponent];
+        return is_negative ? -value : value;
     }
 
-    else {
-        fprintf(stderr, "[%s: %d] Cannot parse decision tree node \"%s\".\n", __FILE__, __LINE__, node_type);
+    /* Anything else goes through strtod, which needs a terminated copy */
+    if (length >= BUFFER_SIZE) {
+        fprintf(stderr, "[%s: %d] Cannot parse number \"%.*s\".\n", __FILE__, __LINE__, (int) length, token);
+        abort();
+    }
+    memcpy(buffer, token, length);
+    buffer[length] = '\0';
+    value = strtod(buffer, &number_end);
+    if (number_end != buffer + length) {
+        fprintf(stderr, "[%s: %d] Cannot parse number \"%s\".\n", __FILE__, __LINE__, buffer);
         abort();
     }
+
+    return value;
 }
 
 
 
-static void skip_split(const unsigned int n_labels, FILE *fh) {
-    unsigned int n, feature;
-    double threshold;
+static void parse_header(struct parser *parser, Dataset *header) {
+    unsigned int i, length, space_size, n_labels;
+    const char *token = next_token(parser, &length);
 
-    n = fscanf(fh, "%u %lf", &feature, &threshold);
-    if (n != 2) {
-        fprintf(stderr, "[%s: %d] Cannot parse decision tree node.\n", __FILE__, __LINE__);
+    if (!is_token(token, length, "classifier-decision-tree")) {
+        fprintf(stderr, "[%s: %d] Cannot parse decision tree.\n", __FILE__, __LINE__);
         abort();
     }
-    skip_node(n_labels, fh);
-    skip_node(n_labels, fh);
-}
-
 
+    /* Parses feature space size and number of labels */
+    space_size = parse_unsigned(parser);
+    n_labels = parse_unsigned(parser);
 
-static void skip_leaf(const unsigned int n_labels, FILE *fh) {
-    unsigned int i, n_samples, n;
-
+    /* Parses labels */
+    dataset_create(header, space_size, 0);
+    header->labels = (char **) malloc(n_labels * sizeof(char *));
     for (i = 0; i < n_labels; ++i) {
-        n = fscanf(fh, "%u", &n_samples);
-        if (n != 1) {
-            fprintf(stderr, "[%s: %d] Parse error.\n", __FILE__, __LINE__);
-        }
+        token = next_token(parser, &length);
+        header->labels[i] = (char *) malloc(length + 1);
+        memcpy(header->labels[i], token, length);
+        header->labels[i][length] = '\0';
+        ++header->n_labels;
     }
 }
 
 
 
-static void skip_logarithmic_leaf(const unsigned int n_labels, FILE *fh) {
-    unsigned int i, n;
-    float value;
+static void parse_logarithmic_leaf(struct parser *parser, Node *node) {
+    const unsigned int n_labels = node->tree->dataset.n_labels;
+    unsigned int i;
+    double value, max_value = 0.0;
 
+    /* Logarithmic leaves carry no counts, labels are the most likely ones */
     for (i = 0; i < n_labels; ++i) {
-        n = fscanf(fh, "%g", &value);
-        if (n != 1) {
-            fprintf(stderr, "[%s: %d] Parse error.\n", __FILE__, __LINE__);
+        value = parse_double(parser);
+        if (i == 0 || value > max_value) {
+            node->labels = BITMASK_NOTHING;
+            max_value = value;
+        }
+        if (value == max_value) {
+            bitmask_set(node->labels, i);
         }
     }
 }
 
 
 
-static void skip_node(const unsigned int n_labels, FILE *fh) {
-    unsigned int n;
-    char node_type[BUFFER_SIZE];
-
-    n = fscanf(fh, "%s", node_type);
-    if (n != 1) {
-        fprintf(stderr, "[%s: %d] Cannot parse decision tree node.\n", __FILE__, __LINE__);
-        abort();
-    }
+/* Nodes come in preorder, so a stack of nodes still to read replaces
+ * recursion and deep trees cannot overflow the call stack */
+static void parse_nodes(struct parser *parser, DecisionTree *tree) {
+    const unsigned int n_labels = tree->dataset.n_labels;
+    unsigned int i, length, feature;
+    double threshold;
+    Stack S, parsed;
 
-    if (strcmp(node_type, "LEAF") == 0) {
-        skip_leaf(n_labels, fh);
+    stack_create(&S);
+    stack_create(&parsed);
+    stack_push(S, tree->root);
+    while (!stack_is_empty(S)) {
+        Node *node = stack_pop(S);
+        const char *token = next_token(parser, &length);
+
+        stack_push(parsed, node);
+        if (is_token(token, length, "SPLIT")) {
+            feature = parse_unsigned(parser);
+            if (feature >= tree->dataset.space_size) {
+                fprintf(stderr, "[%s: %d] Split on feature %u, but space has %u features.\n", __FILE__, __LINE__, feature, tree->dataset.space_size);
+                abort();
+            }
+            threshold = parse_double(parser);
+            node_attach(node, feature, threshold);
+            stack_push(S, node->right);
+            stack_push(S, node->left);
+        }
+        else if (is_token(token, length, "LEAF")) {
+            for (i = 0; i < n_labels; ++i) {
+                node->frequencies[i] = parse_unsigned(parser);
+            }
+            node_set_frequencies(node, node->frequencies);
+        }
+        else if (is_token(token, length, "LEAF_LOGARITHMIC")) {
+            parse_logarithmic_leaf(parser, node);
+        }
+        else {
+            fprintf(stderr, "[%s: %d] Cannot parse decision tree node \"%.*s\".\n", __FILE__, __LINE__, (int) length, token);
+            abort();
+        }
     }
 
-    else if (strcmp(node_type, "LEAF_LOGARITHMIC") == 0) {
-        skip_logarithmic_leaf(n_labels, fh);
-    }
+    /* Internal nodes count the samples of their leaves, children are
+     * popped before their parents */
+    while (!stack_is_empty(parsed)) {
+        Node *node = stack_pop(parsed);
 
-    else if (strcmp(node_type, "SPLIT") == 0) {
-        skip_split(n_labels, fh);
+        if (!node_is_leaf(*node)) {
+            for (i = 0; i < n_labels; ++i) {
+                node->frequencies[i] = node->left->frequencies[i] + node->right->frequencies[i];
+            }
+            node_set_frequencies(node, node->frequencies);
+        }
     }
 
-    else {
-        fprintf(stderr, "[%s: %d] Cannot skip decision tree node \"%s\".\n", __FILE__, __LINE__, node_type);
-        abort();
-    }
+    stack_delete(&S);
+    stack_delete(&parsed);
 }
 
 
 
+
+
+
 /***********************************************************************
  * Pubblic functions.
  **********************************************************************/
 
 void decision_tree_mapper_silva_load(FILE *fh, DecisionTree *tree, const Dataset dataset) {
-    unsigned int n, i, space_size, n_labels;
-    char buffer[BUFFER_SIZE];
+    Dataset header;
 
-    /* Parses header. */
-    n = fscanf(fh, "%s", buffer);
-    if (n != 1 || strcmp(buffer, "classifier-decision-tree") != 0) {
-        fprintf(stderr, "[%s: %d] Cannot parse decision tree.\n", __FILE__, __LINE__);
-        abort();
-    }
+    decision_tree_mapper_silva_load_model(fh, tree, &header);
+    decision_tree_partition(tree, dataset);
+    dataset_delete(header);
+}
 
-    /* Parses feature space size and number of labels */
-    n = fscanf(fh, "%u %u", &space_size, &n_labels);
-    if (n != 2) {
-        fprintf(stderr, "[%s: %d] Cannot parse decision tree.\n", __FILE__, __LINE__);
-        abort();
-    }
 
-    /* Parses labels */
-    for (i = 0; i < n_labels; ++i) {
-        n = fscanf(fh, "%s", buffer);
-        if (n != 1) {
-            fprintf(stderr, "[%s: %d] Cannot parse decision tree.\n", __FILE__, __LINE__);
-            abort();
-        }
-    }
 
-    /* Parses decision tree */
-    decision_tree_create(tree, dataset);
-    parse_node(tree->root, fh);
+void decision_tree_mapper_silva_load_model(FILE *fh, DecisionTree *tree, Dataset *header) {
+    Text text;
+
+    text_open(&text, fh);
+    text_close(&text, decision_tree_mapper_silva_parse_model(text.data, text.end, tree, header));
+}
+
+
+
+const char *decision_tree_mapper_silva_parse_model(const char *text, const char *end, DecisionTree *tree, Dataset *header) {
+    struct parser parser;
+
+    parser.cursor = text;
+    parser.end = end;
+    parse_header(&parser, header);
+    decision_tree_create(tree, *header);
+    parse_nodes(&parser, tree);
+
+    return parser.cursor;
 }
 
 
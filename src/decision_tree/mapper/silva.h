@@ -7,6 +7,16 @@
 
 void decision_tree_mapper_silva_load(FILE *fh, DecisionTree *tree, const Dataset dataset);
 
+/* Loads structure and leaf counts without a training set, header gets
+ * the feature space size and labels of the model as an empty dataset.
+ * Header must outlive the tree, decision_tree_partition computes sample
+ * partitions if needed. */
+void decision_tree_mapper_silva_load_model(FILE *fh, DecisionTree *tree, Dataset *header);
+
+/* Same as above on text in memory, which need not be terminated; returns
+ * a pointer right after the last token of the tree. */
+const char *decision_tree_mapper_silva_parse_model(const char *text, const char *end, DecisionTree *tree, Dataset *header);
+
 void decision_tree_mapper_silva_save(FILE *fh, const DecisionTree tree);
 
 #endif
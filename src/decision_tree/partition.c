@@ -0,0 +1,125 @@
+#include "partition.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/***********************************************************************
+ * Internal functions.
+ **********************************************************************/
+
+static PartitionBlock *block_create(TreePool *pool) {
+    PartitionBlock *block;
+
+    if (pool && !stack_is_empty(pool->blocks)) {
+        block = stack_pop(pool->blocks);
+    }
+    else {
+        block = (PartitionBlock *) malloc(sizeof(PartitionBlock));
+    }
+
+    if (block == NULL) {
+        fprintf(stderr, "[%s: %d] Cannot allocate memory.\n", __FILE__, __LINE__);
+        abort();
+    }
+    block->references = 1;
+
+    return block;
+}
+
+
+
+static void block_release(PartitionBlock *block, TreePool *pool) {
+    --block->references;
+    if (block->references > 0) {
+        return;
+    }
+
+    if (pool) {
+        stack_push(pool->blocks, block);
+    }
+    else {
+        free(block);
+    }
+}
+
+
+
+static PartitionBlock **table_create(const unsigned int n_blocks, TreePool *pool) {
+    if (pool && !stack_is_empty(pool->tables)) {
+        return stack_pop(pool->tables);
+    }
+
+    return (PartitionBlock **) malloc(n_blocks * sizeof(PartitionBlock *));
+}
+
+
+
+/***********************************************************************
+ * Public functions.
+ **********************************************************************/
+
+void partition_create(Partition *partition, const unsigned int size, TreePool *pool) {
+    unsigned int i;
+
+    partition->size = size;
+    partition->n_blocks = (size + PARTITION_BLOCK_SIZE - 1) >> PARTITION_BLOCK_SHIFT;
+    partition->pool = pool;
+    partition->blocks = table_create(partition->n_blocks, pool);
+    for (i = 0; i < partition->n_blocks; ++i) {
+        partition->blocks[i] = block_create(pool);
+    }
+}
+
+
+
+void partition_share(Partition *copy, const Partition partition, TreePool *pool) {
+    unsigned int i;
+
+    copy->size = partition.size;
+    copy->n_blocks = partition.n_blocks;
+    copy->pool = pool;
+    copy->blocks = table_create(partition.n_blocks, pool);
+    for (i = 0; i < partition.n_blocks; ++i) {
+        copy->blocks[i] = partition.blocks[i];
+        ++copy->blocks[i]->references;
+    }
+}
+
+
+
+void partition_delete(Partition partition) {
+    unsigned int i;
+
+    for (i = 0; i < partition.n_blocks; ++i) {
+        block_release(partition.blocks[i], partition.pool);
+    }
+    if (partition.pool) {
+        stack_push(partition.pool->tables, partition.blocks);
+    }
+    else {
+        free(partition.blocks);
+    }
+}
+
+
+
+void partition_detach(Partition partition, const unsigned int first, const unsigned int last) {
+    unsigned int i;
+
+    if (first > last) {
+        return;
+    }
+
+    for (i = first >> PARTITION_BLOCK_SHIFT; i <= last >> PARTITION_BLOCK_SHIFT; ++i) {
+        PartitionBlock *block = partition.blocks[i];
+
+        if (block->references > 1) {
+            partition.blocks[i] = block_create(partition.pool);
+            memcpy(partition.blocks[i]->samples, block->samples, sizeof(block->samples));
+            block_release(block, partition.pool);
+        }
+    }
+}
+
@@ -0,0 +1,48 @@
+#ifndef DECISION_TREE_PARTITION_H
+#define DECISION_TREE_PARTITION_H
+
+#include <stdint.h>
+
+#include "pool.h"
+
+#define PARTITION_BLOCK_SHIFT 10
+#define PARTITION_BLOCK_SIZE (1U << PARTITION_BLOCK_SHIFT)
+
+
+typedef struct partition Partition;
+typedef struct partition_block PartitionBlock;
+
+/* Fixed-size chunk of a partition, shared by every tree referencing it. */
+struct partition_block {
+    unsigned int references;
+    uint32_t samples[PARTITION_BLOCK_SIZE];
+};
+
+/* Ordering of the samples of a tree, as indices into the dataset: each
+ * node owns a contiguous range.
+ * Blocks are copied on write, so trees derived from one another only
+ * own the ranges they actually repartitioned. */
+struct partition {
+    PartitionBlock **blocks;
+    unsigned int n_blocks;
+    unsigned int size;
+    TreePool *pool;
+};
+
+
+#define partition_get(partition, i) \
+    ((partition).blocks[(i) >> PARTITION_BLOCK_SHIFT]->samples[(i) & (PARTITION_BLOCK_SIZE - 1)])
+
+#define partition_set(partition, i, sample) \
+    (partition_get(partition, i) = (uint32_t) (sample))
+
+
+void partition_create(Partition *partition, const unsigned int size, TreePool *pool);
+
+void partition_share(Partition *copy, const Partition partition, TreePool *pool);
+
+void partition_delete(Partition partition);
+
+void partition_detach(Partition partition, const unsigned int first, const unsigned int last);
+
+#endif
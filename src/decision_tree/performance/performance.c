@@ -1,94 +1,461 @@
 #include "performance.h"
+
+#include <stdlib.h>
+#include <math.h>
+
 #include "../../geometry/hyperrectangle.h"
-#include "../../data_structures/stack.h"
+#include "../flat/flat_tree.h"
+
+#define RACE_BLOCK_SIZE 256
+#define BATCH_BLOCK_BYTES 65536
 
 
 /***********************************************************************
  * Internal functions.
  **********************************************************************/
 
-static unsigned int decision_tree_is_stable(
+static void performance_clear(Performance *performance) {
+    performance->samples = 0;
+    performance->correct = 0;
+    performance->wrong = 0;
+    performance->stable = 0;
+    performance->unstable = 0;
+    performance->robust = 0;
+    performance->vulnerable = 0;
+    performance->fragile = 0;
+    performance->broken = 0;
+}
+
+
+
+static int compare_radii(const void *a, const void *b) {
+    const double x = *(const double *) a, y = *(const double *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+
+static unsigned int popcount(const Bitmask b) {
+#ifdef __GNUC__
+    return __builtin_popcountl(b);
+#else
+    unsigned int n;
+    bitmask_cardinality(b, n);
+    return n;
+#endif
+}
+
+
+
+static Bitmask evaluate_block(
+    Bitmask *correct,
+    Bitmask *labels,
+    const FlatTree tree,
+    const Dataset dataset,
+    const unsigned int *sample,
+    const unsigned int first,
+    const unsigned int n,
+    const double *epsilons,
+    const Hyperrectangle *boxes,
+    double *columns
+) {
+    const double *points = sample ? dataset.points : dataset.points + first * dataset.space_size;
+    const unsigned int *block = sample ? sample + first : NULL;
+    unsigned int k;
+
+    flat_tree_classify_batch(labels, tree, points, dataset.space_size, block, n);
+
+    /* Correct when the only label predicted is the true one */
+    *correct = BITMASK_NOTHING;
+    for (k = 0; k < n; ++k) {
+        const unsigned int label = dataset.label_lookup[block ? block[k] : first + k];
+        *correct |= (Bitmask) (labels[k] == 1UL << label) << k;
+    }
+
+    return flat_tree_stable_batch(
+        tree, points, dataset.space_size, block, n, labels,
+        epsilons, boxes && !sample ? boxes + first : boxes, columns
+    );
+}
+
+
+
+static double *feature_epsilons(const Perturbation perturbation, const unsigned int space_size) {
+    double *epsilons = (double *) malloc(space_size * sizeof(double));
+    unsigned int i;
+
+    for (i = 0; i < space_size; ++i) {
+        epsilons[i] = perturbation.scales ? perturbation.epsilon * perturbation.scales[i] : perturbation.epsilon;
+    }
+
+    return epsilons;
+}
+
+
+
+static void performance_add(Performance *performance, const Bitmask correct, const Bitmask stable, const unsigned int n) {
+    const unsigned int robust = popcount(correct & stable),
+                       vulnerable = popcount(bitmask_difference(stable, correct)),
+                       fragile = popcount(bitmask_difference(correct, stable));
+
+    performance->correct += robust + fragile;
+    performance->wrong += n - robust - fragile;
+    performance->stable += robust + vulnerable;
+    performance->unstable += n - robust - vulnerable;
+    performance->robust += robust;
+    performance->vulnerable += vulnerable;
+    performance->fragile += fragile;
+    performance->broken += n - robust - vulnerable - fragile;
+}
+
+
+
+
+
+/***********************************************************************
+ * Public functions.
+ **********************************************************************/
+
+void decision_tree_performance(Performance *performance, const DecisionTree tree, const Dataset dataset, const double epsilon) {
+    Perturbation perturbation;
+
+    perturbation.epsilon = epsilon;
+    perturbation.scales = NULL;
+    perturbation.boxes = NULL;
+    decision_tree_performance_batch(performance, &tree, 1, dataset, perturbation, NULL, dataset.size);
+}
+
+
+
+void decision_tree_performance_sample(
+    Performance *performance,
     const DecisionTree tree,
-    double *sample,
-    const double epsilon,
-    const Bitmask labels,
-    Stack S
+    const Dataset dataset,
+    const Perturbation perturbation,
+    const unsigned int *sample,
+    const unsigned int size
 ) {
-    unsigned int is_stable = 1;
+    decision_tree_performance_batch(performance, &tree, 1, dataset, perturbation, sample, size);
+}
 
-    stack_clear(S);
-    stack_push(S, tree.root);
-    while (!stack_is_empty(S)) {
-        Node *node = stack_pop(S);
 
-        if (node_is_leaf(*node)) {
-            if (labels != node->labels) {
-                is_stable = 0;
-                break;
+
+void decision_tree_performance_batch(
+    Performance *performances,
+    const DecisionTree *trees,
+    const unsigned int n_trees,
+    const Dataset dataset,
+    const Perturbation perturbation,
+    const unsigned int *sample,
+    const unsigned int size
+) {
+    const unsigned int row_size = dataset.space_size * sizeof(double),
+                       block_size = row_size > 0 && row_size < BATCH_BLOCK_BYTES ? BATCH_BLOCK_BYTES / row_size : 1;
+    FlatTree *flat_trees = (FlatTree *) malloc(n_trees * sizeof(FlatTree));
+    double *columns = (double *) malloc(2 * dataset.space_size * FLAT_TREE_BLOCK_SIZE * sizeof(double)),
+           *epsilons = feature_epsilons(perturbation, dataset.space_size);
+    Bitmask labels[FLAT_TREE_BLOCK_SIZE];
+    unsigned int i, j, t;
+
+    for (t = 0; t < n_trees; ++t) {
+        performance_clear(performances + t);
+        performances[t].samples = size;
+        flat_tree_create(flat_trees + t, trees[t]);
+    }
+
+    /* Every tree runs on a block of samples while it is still cached */
+    for (i = 0; i < size; i += block_size) {
+        const unsigned int end = i + block_size < size ? i + block_size : size;
+
+        for (t = 0; t < n_trees; ++t) {
+            for (j = i; j < end; j += FLAT_TREE_BLOCK_SIZE) {
+                const unsigned int n = j + FLAT_TREE_BLOCK_SIZE < end ? FLAT_TREE_BLOCK_SIZE : end - j;
+                Bitmask correct, stable;
+
+                stable = evaluate_block(
+                    &correct, labels, flat_trees[t], dataset, sample, j, n, epsilons, perturbation.boxes, columns
+                );
+                performance_add(performances + t, correct, stable, n);
             }
         }
+    }
+
+    for (t = 0; t < n_trees; ++t) {
+        flat_tree_delete(flat_trees[t]);
+    }
+    free(flat_trees);
+    free(columns);
+    free(epsilons);
+}
+
+
+
+unsigned int decision_tree_performance_race(
+    Performance *performance,
+    const DecisionTree tree,
+    const Dataset dataset,
+    const Perturbation perturbation,
+    const unsigned int *order,
+    const unsigned int size,
+    const double *weights,
+    const double threshold,
+    const double delta
+) {
+    const double n_samples = size,
+                 log_delta = delta > 0.0 ? log(1.0 / delta) : 0.0;
+    double min_weight = weights[0], max_weight = weights[0], sum = 0.0;
+    double *columns = (double *) malloc(2 * dataset.space_size * FLAT_TREE_BLOCK_SIZE * sizeof(double)),
+           *epsilons = feature_epsilons(perturbation, dataset.space_size);
+    Bitmask labels[FLAT_TREE_BLOCK_SIZE];
+    unsigned int i, is_rejected = 0;
+    FlatTree flat_tree;
+
+    for (i = 1; i < 4; ++i) {
+        min_weight = weights[i] < min_weight ? weights[i] : min_weight;
+        max_weight = weights[i] > max_weight ? weights[i] : max_weight;
+    }
+
+    performance_clear(performance);
+    flat_tree_create(&flat_tree, tree);
+
+    i = 0;
+    while (i < size) {
+        const unsigned int n = i + FLAT_TREE_BLOCK_SIZE < size ? FLAT_TREE_BLOCK_SIZE : size - i;
+        Performance block;
+        Bitmask correct, stable;
+
+        stable = evaluate_block(&correct, labels, flat_tree, dataset, order, i, n, epsilons, perturbation.boxes, columns);
+        performance_clear(&block);
+        performance_add(&block, correct, stable, n);
+        performance_add(performance, correct, stable, n);
+        sum += weights[OUTCOME_ROBUST] * block.robust + weights[OUTCOME_VULNERABLE] * block.vulnerable
+             + weights[OUTCOME_FRAGILE] * block.fragile + weights[OUTCOME_BROKEN] * block.broken;
+        i += n;
 
-        else {
-            const unsigned int idx = node->feature;
-            const double k = node->threshold;
+        /* Upper bound on final mean: exact one from the samples left,
+         * Hoeffding-Serfling one (sampling without replacement) when
+         * a confidence level is given. */
+        if (i % RACE_BLOCK_SIZE == 0 && i < size) {
+            const double m = i;
+            double upper_bound = (sum + (n_samples - m) * max_weight) / n_samples;
 
-            if (sample[idx] - epsilon <= k) {
-                stack_push(S, node->left);
+            if (delta > 0.0) {
+                const double bound = sum / m + (max_weight - min_weight) * sqrt((1.0 - (m - 1.0) / n_samples) * log_delta / (2.0 * m));
+                upper_bound = bound < upper_bound ? bound : upper_bound;
             }
-            if (sample[idx] + epsilon > k) {
-                stack_push(S, node->right);
+
+            if (upper_bound < threshold) {
+                is_rejected = 1;
+                break;
             }
         }
     }
+    flat_tree_delete(flat_tree);
+    free(columns);
+    free(epsilons);
+
+    performance->samples = i;
 
-    return is_stable;
+    return is_rejected;
 }
 
 
 
+void outcomes_create(Outcomes *outcomes, const unsigned int size) {
+    const unsigned int n_words = (size + BITMASK_SIZE - 1) / BITMASK_SIZE;
 
+    outcomes->size = size;
+    outcomes->correct = (Bitmask *) calloc(n_words, sizeof(Bitmask));
+    outcomes->stable = (Bitmask *) calloc(n_words, sizeof(Bitmask));
+}
 
-/***********************************************************************
- * Public functions.
- **********************************************************************/
 
-void decision_tree_performance(Performance *performance, const DecisionTree tree, const Dataset dataset, const double epsilon) {
+
+void outcomes_delete(Outcomes outcomes) {
+    free(outcomes.correct);
+    free(outcomes.stable);
+}
+
+
+
+void decision_tree_outcomes(
+    Outcomes *outcomes,
+    const DecisionTree tree,
+    const Dataset dataset,
+    const Perturbation perturbation,
+    const unsigned int *sample
+) {
+    double *columns = (double *) malloc(2 * dataset.space_size * FLAT_TREE_BLOCK_SIZE * sizeof(double)),
+           *epsilons = feature_epsilons(perturbation, dataset.space_size);
+    Bitmask labels[FLAT_TREE_BLOCK_SIZE];
     unsigned int i;
-    Stack S;
+    FlatTree flat_tree;
 
-    performance->samples = dataset.size;
-    performance->correct = 0;
-    performance->wrong = 0;
-    performance->stable = 0;
-    performance->unstable = 0;
-    performance->robust = 0;
-    performance->vulnerable = 0;
-    performance->fragile = 0;
-    performance->broken = 0;
+    flat_tree_create(&flat_tree, tree);
+    for (i = 0; i < outcomes->size; i += FLAT_TREE_BLOCK_SIZE) {
+        const unsigned int n = i + FLAT_TREE_BLOCK_SIZE < outcomes->size ? FLAT_TREE_BLOCK_SIZE : outcomes->size - i;
+
+        outcomes->stable[i / BITMASK_SIZE] = evaluate_block(
+            outcomes->correct + i / BITMASK_SIZE, labels, flat_tree, dataset, sample, i, n,
+            epsilons, perturbation.boxes, columns
+        );
+    }
+    flat_tree_delete(flat_tree);
+
+    free(columns);
+    free(epsilons);
+}
+
+
+
+void outcomes_performance(Performance *performance, const Outcomes outcomes) {
+    unsigned int i;
+
+    performance_clear(performance);
+    performance->samples = outcomes.size;
+    for (i = 0; i < outcomes.size; i += BITMASK_SIZE) {
+        const unsigned int n = i + BITMASK_SIZE < outcomes.size ? BITMASK_SIZE : outcomes.size - i;
+        performance_add(performance, outcomes.correct[i / BITMASK_SIZE], outcomes.stable[i / BITMASK_SIZE], n);
+    }
+}
+
+
+
+double outcomes_agreement(const Outcomes outcomes_1, const Outcomes outcomes_2) {
+    unsigned int i, n_disagreements = 0;
+
+    /* Samples on which trees differ in correctness or stability */
+    for (i = 0; i < outcomes_1.size; i += BITMASK_SIZE) {
+        const unsigned int w = i / BITMASK_SIZE;
+        n_disagreements += popcount(
+            (outcomes_1.correct[w] ^ outcomes_2.correct[w]) | (outcomes_1.stable[w] ^ outcomes_2.stable[w])
+        );
+    }
+
+    return 1.0 - (double) n_disagreements / outcomes_1.size;
+}
+
+
+
+void decision_tree_performance_multi(
+    Performance *performances,
+    const DecisionTree tree,
+    const Dataset dataset,
+    const double *epsilons,
+    const unsigned int n_epsilons
+) {
+    unsigned int *robust = (unsigned int *) calloc(n_epsilons + 1, sizeof(unsigned int)),
+                 *vulnerable = (unsigned int *) calloc(n_epsilons + 1, sizeof(unsigned int));
+    unsigned int i, j, correct = 0;
+    Bitmask labels[FLAT_TREE_BLOCK_SIZE];
+    double radii[FLAT_TREE_BLOCK_SIZE];
+    FlatTree flat_tree;
+
+    flat_tree_create(&flat_tree, tree);
+
+    /* Stability is monotone in epsilon: a sample is stable on a prefix
+     * of the sorted epsilons, recorded as a difference array */
+    for (i = 0; i < dataset.size; i += FLAT_TREE_BLOCK_SIZE) {
+        const unsigned int n = i + FLAT_TREE_BLOCK_SIZE < dataset.size ? FLAT_TREE_BLOCK_SIZE : dataset.size - i;
+        const double *points = dataset.points + i * dataset.space_size;
+
+        flat_tree_classify_batch(labels, flat_tree, points, dataset.space_size, NULL, n);
+        flat_tree_stability_radii(radii, flat_tree, points, dataset.space_size, NULL, n);
+
+        for (j = 0; j < n; ++j) {
+            unsigned int low = 0, high = n_epsilons, n_labels, is_correct;
+
+            while (low < high) {
+                const unsigned int middle = low + (high - low) / 2;
+
+                if (epsilons[middle] < radii[j]) {
+                    low = middle + 1;
+                }
+                else {
+                    high = middle;
+                }
+            }
+
+            bitmask_cardinality(labels[j], n_labels);
+            is_correct = n_labels == 1 && bitmask_is_set(labels[j], dataset.label_lookup[i + j]);
+            correct += is_correct;
+            robust[low] += is_correct;
+            vulnerable[low] += 1 - is_correct;
+        }
+    }
+
+    /* Samples stable up to index k count for every epsilon before k */
+    for (i = n_epsilons; i > 0; --i) {
+        robust[i - 1] += robust[i];
+        vulnerable[i - 1] += vulnerable[i];
+    }
+
+    for (i = 0; i < n_epsilons; ++i) {
+        Performance *performance = performances + i;
+
+        performance_clear(performance);
+        performance->samples = dataset.size;
+        performance->correct = correct;
+        performance->wrong = dataset.size - correct;
+        performance->robust = robust[i + 1];
+        performance->vulnerable = vulnerable[i + 1];
+        performance->stable = performance->robust + performance->vulnerable;
+        performance->unstable = dataset.size - performance->stable;
+        performance->fragile = correct - performance->robust;
+        performance->broken = performance->wrong - performance->vulnerable;
+    }
+
+    flat_tree_delete(flat_tree);
+    free(robust);
+    free(vulnerable);
+}
+
+
+
+void decision_tree_stability_radii(
+    double *radii,
+    const DecisionTree tree,
+    const Dataset dataset,
+    const unsigned int *sample,
+    const unsigned int size
+) {
+    FlatTree flat_tree;
+
+    flat_tree_create(&flat_tree, tree);
+    flat_tree_stability_radii(radii, flat_tree, dataset.points, dataset.space_size, sample, size);
+    flat_tree_delete(flat_tree);
+}
+
+
+
+void decision_tree_stable_counts(
+    unsigned int *counts,
+    double *radii,
+    const unsigned int size,
+    const double *epsilons,
+    const unsigned int n_epsilons
+) {
+    unsigned int i;
+
+    /* A sample is stable at every epsilon below its radius */
+    qsort(radii, size, sizeof(double), compare_radii);
+    for (i = 0; i < n_epsilons; ++i) {
+        unsigned int low = 0, high = size;
+
+        while (low < high) {
+            const unsigned int middle = low + (high - low) / 2;
+
+            if (radii[middle] > epsilons[i]) {
+                high = middle;
+            }
+            else {
+                low = middle + 1;
+            }
+        }
 
-    stack_create(&S);
-    for (i = 0; i < dataset.size; ++i) {
-        double *sample = dataset.points + i * dataset.space_size;
-        unsigned int label = dataset.label_lookup[i];
-        unsigned int is_correct, is_stable;
-        Bitmask labels = decision_tree_classify(tree, sample);
-        unsigned int n_labels;
-
-        bitmask_cardinality(labels, n_labels);
-
-        is_correct = n_labels == 1 && bitmask_is_set(labels, label);
-        is_stable = decision_tree_is_stable(tree, sample, epsilon, labels, S);
-
-        performance->correct += is_correct;
-        performance->wrong += 1 - is_correct;
-        performance->stable += is_stable;
-        performance->unstable += 1 - is_stable;
-        performance->robust += is_correct && is_stable;
-        performance->vulnerable += (1 - is_correct) && is_stable;
-        performance->fragile += is_correct && (1 - is_stable);
-        performance->broken += (1 - is_correct) && (1 - is_stable);
+        counts[i] = size - low;
     }
-    stack_delete(&S);
 }
 
 
@@ -5,8 +5,11 @@
 
 #include "../decision_tree.h"
 #include "../../data/dataset.h"
+#include "../../geometry/hyperrectangle.h"
 
 typedef struct performance Performance;
+typedef struct perturbation Perturbation;
+typedef struct outcomes Outcomes;
 
 struct performance {
     unsigned int samples;
@@ -22,8 +25,107 @@ struct performance {
 };
 
 
+enum outcome {
+    OUTCOME_ROBUST = 0,
+    OUTCOME_VULNERABLE = 1,
+    OUTCOME_FRAGILE = 2,
+    OUTCOME_BROKEN = 3
+};
+
+
+typedef enum outcome Outcome;
+
+
+/* Box each sample may be moved in: epsilon around it, scaled per feature
+ * when scales are given, or boxes[i] for sample i when boxes are given. */
+struct perturbation {
+    double epsilon;
+    const double *scales;
+    const Hyperrectangle *boxes;
+};
+
+
+/* Outcome of a tree on samples, one bit per sample. */
+struct outcomes {
+    unsigned int size;
+    Bitmask *correct;
+    Bitmask *stable;
+};
+
+
 void decision_tree_performance(Performance *performance, const DecisionTree tree, const Dataset dataset, const double epsilon);
 
+void decision_tree_performance_sample(
+    Performance *performance,
+    const DecisionTree tree,
+    const Dataset dataset,
+    const Perturbation perturbation,
+    const unsigned int *sample,
+    const unsigned int size
+);
+
+void decision_tree_performance_batch(
+    Performance *performances,
+    const DecisionTree *trees,
+    const unsigned int n_trees,
+    const Dataset dataset,
+    const Perturbation perturbation,
+    const unsigned int *sample,
+    const unsigned int size
+);
+
+unsigned int decision_tree_performance_race(
+    Performance *performance,
+    const DecisionTree tree,
+    const Dataset dataset,
+    const Perturbation perturbation,
+    const unsigned int *order,
+    const unsigned int size,
+    const double *weights,
+    const double threshold,
+    const double delta
+);
+
+void outcomes_create(Outcomes *outcomes, const unsigned int size);
+
+void outcomes_delete(Outcomes outcomes);
+
+void decision_tree_outcomes(
+    Outcomes *outcomes,
+    const DecisionTree tree,
+    const Dataset dataset,
+    const Perturbation perturbation,
+    const unsigned int *sample
+);
+
+void outcomes_performance(Performance *performance, const Outcomes outcomes);
+
+double outcomes_agreement(const Outcomes outcomes_1, const Outcomes outcomes_2);
+
+void decision_tree_performance_multi(
+    Performance *performances,
+    const DecisionTree tree,
+    const Dataset dataset,
+    const double *epsilons,
+    const unsigned int n_epsilons
+);
+
+void decision_tree_stability_radii(
+    double *radii,
+    const DecisionTree tree,
+    const Dataset dataset,
+    const unsigned int *sample,
+    const unsigned int size
+);
+
+void decision_tree_stable_counts(
+    unsigned int *counts,
+    double *radii,
+    const unsigned int size,
+    const double *epsilons,
+    const unsigned int n_epsilons
+);
+
 void decision_tree_performance_print(FILE *fh, const Performance performance);
 
 #endif
@@ -0,0 +1,37 @@
+#include "pool.h"
+
+#include <stdlib.h>
+
+#include "decision_tree.h"
+
+
+/***********************************************************************
+ * Public functions.
+ **********************************************************************/
+
+void tree_pool_create(TreePool *pool) {
+    stack_create(&pool->nodes);
+    stack_create(&pool->blocks);
+    stack_create(&pool->tables);
+}
+
+
+
+void tree_pool_delete(TreePool *pool) {
+    while (!stack_is_empty(pool->nodes)) {
+        Node *node = stack_pop(pool->nodes);
+        free(node->frequencies);
+        free(node->probabilities);
+        free(node);
+    }
+    while (!stack_is_empty(pool->blocks)) {
+        free(stack_pop(pool->blocks));
+    }
+    while (!stack_is_empty(pool->tables)) {
+        free(stack_pop(pool->tables));
+    }
+
+    stack_delete(&pool->nodes);
+    stack_delete(&pool->blocks);
+    stack_delete(&pool->tables);
+}
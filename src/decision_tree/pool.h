@@ -0,0 +1,22 @@
+#ifndef DECISION_TREE_POOL_H
+#define DECISION_TREE_POOL_H
+
+#include "../data_structures/stack.h"
+
+
+typedef struct tree_pool TreePool;
+
+/* Storage retired by deleted trees, handed out again to new trees built
+ * on the same dataset instead of going through the allocator. */
+struct tree_pool {
+    Stack nodes;
+    Stack blocks;
+    Stack tables;
+};
+
+
+void tree_pool_create(TreePool *pool);
+
+void tree_pool_delete(TreePool *pool);
+
+#endif
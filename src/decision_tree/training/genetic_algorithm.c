@@ -1,5 +1,8 @@
+#define _POSIX_C_SOURCE 200112L
 #define DEFAULT_FITNESS fitness_linear
+#define DEFAULT_FITNESS_BATCH fitness_linear_batch
 #define DEFAULT_SELECT select_roulette_wheel
+#define DEFAULT_TOURNAMENT_SIZE 2
 #define DEFAULT_CROSSOVER crossover_one_point
 #define DEFAULT_MUTATION mutation_z
 #define DEFAULT_BASE_MUTATION_PROBABILITY 1.0
@@ -9,21 +12,59 @@
 #define DEFAULT_POPULATION_NEXT_SIZE next_population_size_constant
 #define DEFAULT_POPULATION_GENERATOR initial_population_blank
 #define DEFAULT_MAX_ITERATION 64
+#define DEFAULT_TIME_LIMIT 0.0
+#define DEFAULT_PATIENCE 0
+#define DEFAULT_PATIENCE_DELTA 0.0
 #define DEFAULT_ELITISM 1
 #define DEFAULT_SPLIT_SEARCH_AGGRESSIVENESS 0.01
 #define DEFAULT_ALLOW_FEATURES allow_features_all
+#define DEFAULT_RACING_DELTA 0.0
+#define DEFAULT_RACING_ATTEMPTS 0
+#define DEFAULT_SAMPLE_SCHEDULE_FRACTION 1.0
+#define DEFAULT_SAMPLE_SCHEDULE_GROWTH 1.0
+#define DEFAULT_DUPLICATES DUPLICATES_KEEP
 #define DEFAULT_SEED 0
+#define DEFAULT_CHECKPOINT_INTERVAL 0
 
 #include "genetic_algorithm.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 
+#include "../../data_structures/counters.h"
 #include "../../data_structures/stack.h"
+#include "../../data_structures/stopwatch.h"
 #include "../performance/performance.h"
+#include "../mapper/binary.h"
 #include "../../forest/forest.h"
 #include "../../forest/mapper/silva.h"
 
+#define NO_TWIN UINT_MAX
+#define CHECKPOINT_MAGIC "MSGA"
+#define CHECKPOINT_VERSION 3
+#define GENERATION_SEED_STRIDE 2654435761U
+
+#ifdef PROFILE
+#define PROFILE_START(status, phase) stopwatch_start((status)->profile.stopwatches[phase])
+#define PROFILE_STOP(status, phase) (stopwatch_pause((status)->profile.stopwatches[phase]), ++(status)->profile.calls[phase])
+#define PROFILE_ADD(status, counter, n) ((status)->profile.counter += (n))
+#else
+#define PROFILE_START(status, phase)
+#define PROFILE_STOP(status, phase)
+#define PROFILE_ADD(status, counter, n)
+#endif
+
+
+struct ranking {
+    double fitness;
+    unsigned int index;
+};
+
 
 /***********************************************************************
  * Internal functions.
@@ -32,6 +73,536 @@
 static void population_alloc(Population *population, const unsigned int size) {
     population->individuals = (Individual *) realloc(population->individuals, size * sizeof(Individual));
     population->fitness = (double *) realloc(population->fitness, size * sizeof(double));
+    population->raw_fitness = (double *) realloc(population->raw_fitness, size * sizeof(double));
+    population->fingerprints = (unsigned long *) realloc(population->fingerprints, size * sizeof(unsigned long));
+}
+
+
+
+static void shuffle(unsigned int *order, const unsigned int size) {
+    unsigned int i;
+
+    for (i = 0; i < size; ++i) {
+        order[i] = i;
+    }
+    for (i = size; i > 1; --i) {
+        const unsigned int j = rand() % i,
+                           buffer = order[i - 1];
+        order[i - 1] = order[j];
+        order[j] = buffer;
+    }
+}
+
+
+
+static void stratify(unsigned int *order, const Dataset dataset) {
+    unsigned int i, j,
+                 *buffer = (unsigned int *) malloc(dataset.size * sizeof(unsigned int)),
+                 *counts = (unsigned int *) calloc(dataset.n_labels, sizeof(unsigned int)),
+                 *offsets = (unsigned int *) calloc(dataset.n_labels, sizeof(unsigned int)),
+                 *taken = (unsigned int *) calloc(dataset.n_labels, sizeof(unsigned int));
+
+    /* Groups shuffled samples by label */
+    shuffle(order, dataset.size);
+    for (i = 0; i < dataset.size; ++i) {
+        ++counts[dataset.label_lookup[i]];
+    }
+    for (j = 1; j < dataset.n_labels; ++j) {
+        offsets[j] = offsets[j - 1] + counts[j - 1];
+    }
+    for (i = 0; i < dataset.size; ++i) {
+        const unsigned int label = dataset.label_lookup[order[i]];
+        buffer[offsets[label] + taken[label]] = order[i];
+        ++taken[label];
+    }
+
+    /* Interleaves labels so that every prefix keeps their proportions */
+    memset(taken, 0, dataset.n_labels * sizeof(unsigned int));
+    for (i = 0; i < dataset.size; ++i) {
+        unsigned int label = 0;
+        double max_deficit = -HUGE_VAL;
+
+        for (j = 0; j < dataset.n_labels; ++j) {
+            const double deficit = (i + 1.0) * counts[j] / dataset.size - taken[j];
+            if (taken[j] < counts[j] && deficit > max_deficit) {
+                max_deficit = deficit;
+                label = j;
+            }
+        }
+        order[i] = buffer[offsets[label] + taken[label]];
+        ++taken[label];
+    }
+
+    free(buffer);
+    free(counts);
+    free(offsets);
+    free(taken);
+}
+
+
+
+/* Orders samples for racing and progressive evaluation, if either is enabled */
+static unsigned int *evaluation_order_create(const Status *status, const Dataset training_set) {
+    unsigned int *order = NULL;
+
+    if (status->sample_schedule_fraction < 1.0) {
+        order = (unsigned int *) malloc(training_set.size * sizeof(unsigned int));
+        stratify(order, training_set);
+    }
+    else if (status->racing_attempts > 0) {
+        order = (unsigned int *) malloc(training_set.size * sizeof(unsigned int));
+        shuffle(order, training_set.size);
+    }
+
+    return order;
+}
+
+
+
+static void selection_prepare(Status *status) {
+    const Population population = status->population;
+    unsigned int i;
+    double sum = 0.0;
+
+    /* Cumulative wheel of non-negative fitness, built once per
+     * generation so that each selection is a binary search */
+    status->selection_cumulative = (double *) realloc(status->selection_cumulative, population.size * sizeof(double));
+    status->selection_picks = (unsigned int *) realloc(status->selection_picks, population.size * sizeof(unsigned int));
+    for (i = 0; i < population.size; ++i) {
+        sum += population.fitness[i] > 0.0 ? population.fitness[i] : 0.0;
+        status->selection_cumulative[i] = sum;
+    }
+    status->n_selection_picks = 0;
+}
+
+
+
+static unsigned int selection_spin(const double *cumulative, const unsigned int size, const double p) {
+    unsigned int low = 0, high = size - 1;
+
+    while (low < high) {
+        const unsigned int middle = low + (high - low) / 2;
+        if (cumulative[middle] > p) {
+            high = middle;
+        }
+        else {
+            low = middle + 1;
+        }
+    }
+
+    return low;
+}
+
+
+
+static unsigned int scheduled_sample_size(const Status *status, const unsigned int size) {
+    const double fraction = status->sample_schedule_fraction * pow(status->sample_schedule_growth, status->current_iteration);
+
+    if (fraction >= 1.0) {
+        return size;
+    }
+
+    return fraction * size < 1.0 ? 1 : (unsigned int) ceil(fraction * size);
+}
+
+
+
+static void population_rescore(Population *population, Status *status) {
+    unsigned int i, j;
+
+    for (i = 0; i < population->size; ++i) {
+        const Individual individual = population->individuals[i];
+        const unsigned long fingerprint = population->fingerprints[i];
+        const double penalty = population->raw_fitness[i] - population->fitness[i];
+        double raw_fitness, fitness;
+
+        /* Duplicates keep their penalty on the new score */
+        PROFILE_START(status, PROFILE_FITNESS);
+        raw_fitness = status->compute_fitness(individual, status);
+        PROFILE_STOP(status, PROFILE_FITNESS);
+        PROFILE_ADD(status, samples_traversed, status->evaluation_size);
+        fitness = raw_fitness - penalty;
+
+        for (j = i; j > 0 && population->fitness[j - 1] < fitness; --j) {
+            population->individuals[j] = population->individuals[j - 1];
+            population->fitness[j] = population->fitness[j - 1];
+            population->raw_fitness[j] = population->raw_fitness[j - 1];
+            population->fingerprints[j] = population->fingerprints[j - 1];
+        }
+        population->individuals[j] = individual;
+        population->fitness[j] = fitness;
+        population->raw_fitness[j] = raw_fitness;
+        population->fingerprints[j] = fingerprint;
+    }
+}
+
+
+
+static unsigned int fingerprint_slot(const unsigned long *keys, const unsigned int *codes, const unsigned int capacity, const unsigned long fingerprint) {
+    unsigned int slot = (unsigned int) (fingerprint ^ (fingerprint >> 32)) & (capacity - 1);
+
+    /* Linear probing, the table is never more than half full */
+    while (codes[slot] != NO_TWIN && keys[slot] != fingerprint) {
+        slot = (slot + 1) & (capacity - 1);
+    }
+
+    return slot;
+}
+
+
+
+static int compare_ranking(const void *a, const void *b) {
+    const struct ranking *x = (const struct ranking *) a,
+                         *y = (const struct ranking *) b;
+
+    if (x->fitness != y->fitness) {
+        return x->fitness < y->fitness ? 1 : -1;
+    }
+
+    return (x->index < y->index) - (x->index > y->index);
+}
+
+
+
+static int compare_fingerprints(const void *a, const void *b) {
+    const unsigned long x = *(const unsigned long *) a,
+                        y = *(const unsigned long *) b;
+
+    return (x > y) - (x < y);
+}
+
+
+
+static unsigned int distinct_individuals(const Population population) {
+    unsigned long *fingerprints = (unsigned long *) malloc(population.size * sizeof(unsigned long));
+    unsigned int i, n = population.size > 0;
+
+    memcpy(fingerprints, population.fingerprints, population.size * sizeof(unsigned long));
+    qsort(fingerprints, population.size, sizeof(unsigned long), compare_fingerprints);
+    for (i = 1; i < population.size; ++i) {
+        n += fingerprints[i] != fingerprints[i - 1];
+    }
+    free(fingerprints);
+
+    return n;
+}
+
+
+
+static void options_append(Status *status, const char *option) {
+    char *copy = (char *) malloc(strlen(option) + 1);
+
+    strcpy(copy, option);
+    status->options = (char **) realloc(status->options, (status->n_options + 1) * sizeof(char *));
+    status->options[status->n_options++] = copy;
+}
+
+
+
+/* Removes a previously recorded option together with its arguments */
+static void options_remove(Status *status, const char *option) {
+    unsigned int i = 0, j, n = 0;
+
+    while (i < status->n_options) {
+        if (strcmp(status->options[i], option) != 0) {
+            status->options[n++] = status->options[i++];
+            continue;
+        }
+        for (j = i++; i < status->n_options && strncmp(status->options[i], "--", 2) != 0; ++i);
+        for (; j < i; ++j) {
+            free(status->options[j]);
+        }
+    }
+    status->n_options = n;
+}
+
+
+
+/* Options bound to a single run, which a resumed run does not inherit */
+static unsigned int is_run_option(const char *option) {
+    return strcmp(option, "--resume") == 0
+        || strcmp(option, "--checkpoint") == 0
+        || strcmp(option, "--profile") == 0;
+}
+
+
+
+/* Records options for checkpoints, a later one replacing an earlier one of same name */
+static void options_record(Status *status, int argc, char **argv) {
+    unsigned int is_recorded = 0;
+    int i;
+
+    for (i = 0; i < argc; ++i) {
+        if (strncmp(argv[i], "--", 2) == 0) {
+            is_recorded = !is_run_option(argv[i]);
+            if (is_recorded) {
+                options_remove(status, argv[i]);
+            }
+        }
+        if (is_recorded) {
+            options_append(status, argv[i]);
+        }
+    }
+}
+
+
+
+static unsigned int checkpoint_save(FILE *fh, const Status *status, const unsigned int next_iteration) {
+    const unsigned int version = CHECKPOINT_VERSION,
+                       dataset_size = status->population.individuals[0].dataset.size,
+                       has_order = status->evaluation_order != NULL;
+    unsigned int i, ok = 1;
+
+    ok &= fwrite(CHECKPOINT_MAGIC, 1, 4, fh) == 4;
+    ok &= fwrite(&version, sizeof(unsigned int), 1, fh) == 1;
+    ok &= fwrite(&status->n_options, sizeof(unsigned int), 1, fh) == 1;
+    for (i = 0; i < status->n_options; ++i) {
+        const unsigned int length = strlen(status->options[i]);
+        ok &= fwrite(&length, sizeof(unsigned int), 1, fh) == 1;
+        ok &= fwrite(status->options[i], 1, length, fh) == length;
+    }
+
+    ok &= fwrite(&next_iteration, sizeof(unsigned int), 1, fh) == 1;
+    ok &= fwrite(&status->evaluation_size, sizeof(unsigned int), 1, fh) == 1;
+    ok &= fwrite(&status->best_fitness, sizeof(double), 1, fh) == 1;
+    ok &= fwrite(&status->n_stalled, sizeof(unsigned int), 1, fh) == 1;
+    ok &= fwrite(&status->n_allowed_features, sizeof(unsigned int), 1, fh) == 1;
+    ok &= fwrite(status->allowed_features, sizeof(unsigned int), status->n_allowed_features, fh) == status->n_allowed_features;
+    ok &= fwrite(&has_order, sizeof(unsigned int), 1, fh) == 1;
+    if (has_order) {
+        ok &= fwrite(status->evaluation_order, sizeof(unsigned int), dataset_size, fh) == dataset_size;
+    }
+
+    ok &= fwrite(&status->population.size, sizeof(unsigned int), 1, fh) == 1;
+    ok &= fwrite(status->population.fitness, sizeof(double), status->population.size, fh) == status->population.size;
+    ok &= fwrite(status->population.raw_fitness, sizeof(double), status->population.size, fh) == status->population.size;
+    for (i = 0; i < status->population.size; ++i) {
+        decision_tree_mapper_binary_save(fh, status->population.individuals[i]);
+    }
+
+    return ok;
+}
+
+
+
+static void checkpoint_read(void *data, const size_t size, const size_t n, FILE *fh) {
+    if (fread(data, size, n, fh) != n) {
+        fprintf(stderr, "[%s: %d] Truncated checkpoint.\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+
+static char **checkpoint_load_options(FILE *fh, unsigned int *n_options) {
+    unsigned int i, version;
+    char magic[4], **options;
+
+    checkpoint_read(magic, 1, 4, fh);
+    checkpoint_read(&version, sizeof(unsigned int), 1, fh);
+    if (memcmp(magic, CHECKPOINT_MAGIC, 4) != 0 || version != CHECKPOINT_VERSION) {
+        fprintf(stderr, "[%s: %d] Not a checkpoint, or written by another version.\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+
+    checkpoint_read(n_options, sizeof(unsigned int), 1, fh);
+    options = (char **) malloc(*n_options * sizeof(char *));
+    for (i = 0; i < *n_options; ++i) {
+        unsigned int length;
+        checkpoint_read(&length, sizeof(unsigned int), 1, fh);
+        options[i] = (char *) malloc(length + 1);
+        checkpoint_read(options[i], 1, length, fh);
+        options[i][length] = '\0';
+    }
+
+    return options;
+}
+
+
+
+static unsigned int checkpoint_load_state(FILE *fh, Status *status, const Dataset training_set) {
+    unsigned int i, next_iteration, has_order, size;
+
+    checkpoint_read(&next_iteration, sizeof(unsigned int), 1, fh);
+    checkpoint_read(&status->evaluation_size, sizeof(unsigned int), 1, fh);
+    checkpoint_read(&status->best_fitness, sizeof(double), 1, fh);
+    checkpoint_read(&status->n_stalled, sizeof(unsigned int), 1, fh);
+    checkpoint_read(&status->n_allowed_features, sizeof(unsigned int), 1, fh);
+    if (status->evaluation_size > training_set.size || status->n_allowed_features > training_set.space_size) {
+        fprintf(stderr, "[%s: %d] Checkpoint does not match training set.\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    status->allowed_features = (unsigned int *) malloc(status->n_allowed_features * sizeof(unsigned int));
+    checkpoint_read(status->allowed_features, sizeof(unsigned int), status->n_allowed_features, fh);
+    checkpoint_read(&has_order, sizeof(unsigned int), 1, fh);
+    if (has_order) {
+        status->evaluation_order = (unsigned int *) malloc(training_set.size * sizeof(unsigned int));
+        checkpoint_read(status->evaluation_order, sizeof(unsigned int), training_set.size, fh);
+    }
+
+    /* Indices come from a file, so they are checked before use */
+    for (i = 0; i < status->n_allowed_features; ++i) {
+        if (status->allowed_features[i] >= training_set.space_size) {
+            fprintf(stderr, "[%s: %d] Checkpoint does not match training set.\n", __FILE__, __LINE__);
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (i = 0; has_order && i < training_set.size; ++i) {
+        if (status->evaluation_order[i] >= training_set.size) {
+            fprintf(stderr, "[%s: %d] Checkpoint does not match training set.\n", __FILE__, __LINE__);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    checkpoint_read(&size, sizeof(unsigned int), 1, fh);
+    if (size > status->max_population_size) {
+        fprintf(stderr, "[%s: %d] Checkpoint holds %u individuals, more than maximum population size.\n", __FILE__, __LINE__, size);
+        exit(EXIT_FAILURE);
+    }
+    checkpoint_read(status->population.fitness, sizeof(double), size, fh);
+    checkpoint_read(status->population.raw_fitness, sizeof(double), size, fh);
+    for (i = 0; i < size; ++i) {
+        decision_tree_mapper_binary_load(fh, status->population.individuals + i, training_set);
+    }
+    status->population.size = size;
+
+    return next_iteration;
+}
+
+
+
+static void checkpoint_wait(Status *status) {
+    int writer_status;
+
+    if (status->checkpoint_writer <= 0) {
+        return;
+    }
+
+    waitpid((pid_t) status->checkpoint_writer, &writer_status, 0);
+    if (!WIFEXITED(writer_status) || WEXITSTATUS(writer_status) != EXIT_SUCCESS) {
+        fprintf(stderr, "[%s: %d] Cannot write checkpoint \"%s\".\n", __FILE__, __LINE__, status->checkpoint_path);
+    }
+    status->checkpoint_writer = 0;
+}
+
+
+
+static unsigned int checkpoint_write(const Status *status, const unsigned int next_iteration) {
+    char path[PATH_SIZE + 8];
+    unsigned int ok;
+    FILE *fh;
+
+    /* Writes aside and renames, so that a crash never leaves a torn
+     * checkpoint behind */
+    sprintf(path, "%s.tmp", status->checkpoint_path);
+    fh = fopen(path, "wb");
+    if (fh == NULL) {
+        return 0;
+    }
+    ok = checkpoint_save(fh, status, next_iteration);
+    ok &= fclose(fh) == 0;
+
+    return ok && rename(path, status->checkpoint_path) == 0;
+}
+
+
+
+static void checkpoint(Status *status, const unsigned int next_iteration) {
+    pid_t writer;
+
+    /* A forked writer sees a frozen copy of the population, so training
+     * goes on while it is written */
+    checkpoint_wait(status);
+    writer = fork();
+    if (writer == 0) {
+        _exit(checkpoint_write(status, next_iteration) ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+    else if (writer > 0) {
+        status->checkpoint_writer = (long) writer;
+    }
+    else if (!checkpoint_write(status, next_iteration)) {
+        fprintf(stderr, "[%s: %d] Cannot write checkpoint \"%s\".\n", __FILE__, __LINE__, status->checkpoint_path);
+    }
+}
+
+
+
+#ifdef PROFILE
+static void profile_reset(struct profile *profile) {
+    unsigned int i;
+
+    for (i = 0; i < PROFILE_N_PHASES; ++i) {
+        stopwatch_reset(profile->stopwatches[i]);
+        profile->calls[i] = 0;
+    }
+    profile->nodes_created = 0;
+    profile->splits_scored = 0;
+    profile->samples_traversed = 0;
+}
+#endif
+
+
+
+static Perturbation linear_perturbation(const FitnessParameters parameters) {
+    Perturbation perturbation;
+
+    perturbation.epsilon = parameters.linear.weights[0];
+    perturbation.scales = parameters.linear.epsilon_scales;
+    perturbation.boxes = parameters.linear.boxes;
+
+    return perturbation;
+}
+
+
+
+static double linear_combination(const Performance performance, const double *parameters) {
+    return parameters[1] * (double) performance.correct / performance.samples
+         + parameters[2] * (double) performance.wrong / performance.samples
+         + parameters[3] * (double) performance.stable / performance.samples
+         + parameters[4] * (double) performance.unstable / performance.samples
+         + parameters[5] * (1.0 - (double) (performance.stable + performance.unstable) / performance.samples)
+         + parameters[6] * (double) performance.robust / performance.samples
+         + parameters[7] * (double) performance.vulnerable / performance.samples
+         + parameters[8] * (double) performance.fragile / performance.samples
+         + parameters[9] * (double) performance.broken / performance.samples;
+}
+
+
+
+static void breed(Individual *offspring, Status *status) {
+    Individual parent_a, parent_b;
+    double mutation_probability;
+
+    PROFILE_START(status, PROFILE_SELECTION);
+    parent_a = status->select(status->population, status);
+    parent_b = status->select(status->population, status);
+    PROFILE_STOP(status, PROFILE_SELECTION);
+    mutation_probability = status->mutation_probability(status->base_mutation_probability, status);
+
+    PROFILE_START(status, PROFILE_CROSSOVER);
+    status->crossover(offspring, parent_a, parent_b, status);
+    PROFILE_STOP(status, PROFILE_CROSSOVER);
+    PROFILE_ADD(status, nodes_created, decision_tree_n_nodes(*offspring));
+    if ((double) rand() / RAND_MAX < mutation_probability) {
+        PROFILE_START(status, PROFILE_MUTATION);
+        status->mutate(offspring, status);
+        PROFILE_STOP(status, PROFILE_MUTATION);
+    }
+}
+
+
+
+static double worst_fitness(const Population population) {
+    unsigned int i;
+    double worst = population.fitness[0];
+
+    for (i = 1; i < population.size; ++i) {
+        if (population.fitness[i] < worst) {
+            worst = population.fitness[i];
+        }
+    }
+
+    return worst;
 }
 
 
@@ -57,6 +628,62 @@ static Node *choose_subtree(const DecisionTree tree) {
 
 
 
+static Node *corresponding_node(const Node *node, const DecisionTree tree) {
+    Node *current_node = tree.root;
+    Stack S;
+
+    stack_create(&S);
+    while (!node_is_root(*node)) {
+        stack_push(S, node);
+        node = node->parent;
+    }
+    while (!stack_is_empty(S)) {
+        const Node *child = stack_pop(S);
+        current_node = child == child->parent->left ? current_node->left : current_node->right;
+    }
+    stack_delete(&S);
+
+    return current_node;
+}
+
+
+
+static void graft_subtree(Node *node, const Node *subtree) {
+    Stack S_subtree, S_node;
+
+    stack_create(&S_subtree);
+    stack_create(&S_node);
+    stack_push(S_subtree, subtree);
+    stack_push(S_node, node);
+
+    while (!stack_is_empty(S_subtree)) {
+        const Node *node_subtree = stack_pop(S_subtree);
+        Node *node_graft = stack_pop(S_node);
+        SplitResult split_result;
+
+        if (node_is_leaf(*node_subtree)) {
+            continue;
+        }
+
+        split_result = node_split(node_graft, node_subtree->feature, node_subtree->threshold);
+        if (split_result == SPLIT_BOTH) {
+            stack_push(S_node, node_graft->right);
+            stack_push(S_node, node_graft->left);
+            stack_push(S_subtree, node_subtree->right);
+            stack_push(S_subtree, node_subtree->left);
+        }
+        else {
+            stack_push(S_node, node_graft);
+            stack_push(S_subtree, split_result == SPLIT_LEFT ? node_subtree->left : node_subtree->right);
+        }
+    }
+
+    stack_delete(&S_subtree);
+    stack_delete(&S_node);
+}
+
+
+
 static double subscore(const double *probabilities, const unsigned int n_labels) {
     unsigned int i;
     double score = 1.0;
@@ -72,19 +699,23 @@ static double subscore(const double *probabilities, const unsigned int n_labels)
 
 static double split_candidate_score(const Node node, const unsigned int feature, const double threshold, double *buffer) {
     const Dataset dataset = node.tree->dataset;
-    const double n_samples = node.last_sample_idx - node.first_sample_idx + 1.0,
-                 **samples = (const double **) node.tree->samples;
+    const double n_samples = node.last_sample_idx - node.first_sample_idx + 1.0;
+    const Partition samples = node.tree->samples;
     const unsigned int *labels = dataset.label_lookup,
                        n_labels = dataset.n_labels;
     unsigned int i, n_left = 0, n_right = 0;
 
+    counter_add(COUNTER_SPLIT_SCORES, 1);
+    counter_add(COUNTER_SPLIT_SAMPLES_SCANNED, node.last_sample_idx - node.first_sample_idx + 1);
+
     for (i = 0; i < 2 * n_labels; ++i) {
         buffer[i] = 0.0;
     }
 
     for (i = node.first_sample_idx; i <= node.last_sample_idx; ++i) {
-        const unsigned int label = labels[(samples[i] - dataset.points) / dataset.space_size];
-        if (samples[i][feature] <= threshold) {
+        const uint32_t sample = partition_get(samples, i);
+        const unsigned int label = labels[sample];
+        if (dataset.points[sample * dataset.space_size + feature] <= threshold) {
             buffer[label] += 1.0;
             ++n_left;
         }
@@ -110,9 +741,8 @@ static void split_trial(unsigned int *feature, double *threshold, const Node nod
     double max_score = 0.0;
 
     *feature = status->allowed_features[rand() % status->n_allowed_features];
-     *threshold = node.tree->samples[
-        (rand() % (node.last_sample_idx - node.first_sample_idx + 1)) + node.first_sample_idx
-    ][*feature];
+    i = (rand() % (node.last_sample_idx - node.first_sample_idx + 1)) + node.first_sample_idx;
+    *threshold = dataset.points[partition_get(node.tree->samples, i) * dataset.space_size + *feature];
 
 
     for (i = 0; i < status->n_allowed_features; ++i) {
@@ -127,6 +757,8 @@ static void split_trial(unsigned int *feature, double *threshold, const Node nod
            }
            value = ((double) rand() / RAND_MAX) * (dataset.projections[d][j + 1] - dataset.projections[d][j]) + dataset.projections[d][j];
            score = split_candidate_score(node, d, value, buffer);
+           PROFILE_ADD(status, splits_scored, 1);
+           PROFILE_ADD(status, samples_traversed, node.last_sample_idx - node.first_sample_idx + 1);
            if (score > max_score) {
                max_score = score; 
                *feature = d;
@@ -144,19 +776,20 @@ static void split_trial(unsigned int *feature, double *threshold, const Node nod
  * Parsing functions.
  **********************************************************************/
 
-static void parse_fitness(Fitness *fitness, FitnessParameters *fitness_parameters, int argc, char **argv) {
+static void parse_fitness(Fitness *fitness, FitnessBatch *fitness_batch, FitnessParameters *fitness_parameters, int argc, char **argv) {
     if (argc > 11 && strcmp(argv[1], "linear") == 0) {
         *fitness = fitness_linear;
-        sscanf(argv[2], "%lf", fitness_parameters->linear + 0);
-        sscanf(argv[3], "%lf", fitness_parameters->linear + 1);
-        sscanf(argv[4], "%lf", fitness_parameters->linear + 2);
-        sscanf(argv[5], "%lf", fitness_parameters->linear + 3);
-        sscanf(argv[6], "%lf", fitness_parameters->linear + 4);
-        sscanf(argv[7], "%lf", fitness_parameters->linear + 5);
-        sscanf(argv[8], "%lf", fitness_parameters->linear + 6);
-        sscanf(argv[9], "%lf", fitness_parameters->linear + 7);
-        sscanf(argv[10], "%lf", fitness_parameters->linear + 8);
-        sscanf(argv[11], "%lf", fitness_parameters->linear + 9);
+        *fitness_batch = fitness_linear_batch;
+        sscanf(argv[2], "%lf", fitness_parameters->linear.weights + 0);
+        sscanf(argv[3], "%lf", fitness_parameters->linear.weights + 1);
+        sscanf(argv[4], "%lf", fitness_parameters->linear.weights + 2);
+        sscanf(argv[5], "%lf", fitness_parameters->linear.weights + 3);
+        sscanf(argv[6], "%lf", fitness_parameters->linear.weights + 4);
+        sscanf(argv[7], "%lf", fitness_parameters->linear.weights + 5);
+        sscanf(argv[8], "%lf", fitness_parameters->linear.weights + 6);
+        sscanf(argv[9], "%lf", fitness_parameters->linear.weights + 7);
+        sscanf(argv[10], "%lf", fitness_parameters->linear.weights + 8);
+        sscanf(argv[11], "%lf", fitness_parameters->linear.weights + 9);
     }
     else {
         fprintf(stderr, "[%s: %d] Unknown type of fitness function \"%s\".\n", __FILE__, __LINE__, argv[1]);
@@ -166,13 +799,20 @@ static void parse_fitness(Fitness *fitness, FitnessParameters *fitness_parameter
 
 
 
-static void parse_select(Select *select, int argc, char **argv) {
+static void parse_select(Select *select, unsigned int *tournament_size, int argc, char **argv) {
     if (argc > 1 && strcmp(argv[1], "uniform") == 0) {
         *select = select_uniform;
     }
     else if (argc > 1 && strcmp(argv[1], "roulette-wheel") == 0) {
         *select = select_roulette_wheel;
     }
+    else if (argc > 1 && strcmp(argv[1], "stochastic-universal") == 0) {
+        *select = select_stochastic_universal;
+    }
+    else if (argc > 2 && strcmp(argv[1], "tournament") == 0) {
+        *select = select_tournament;
+        sscanf(argv[2], "%u", tournament_size);
+    }
     else {
         fprintf(stderr, "[%s: %d] Unknown type of selection function \"%s\".\n", __FILE__, __LINE__, argv[1]);
         exit(EXIT_FAILURE);
@@ -262,145 +902,423 @@ static void parse_population_next_size(NextPopulationSize *next_population_size,
 
 
 
-static void parse_population_generator(InitialPopulation *initial_population, InitialPopulationParameters *parameters, int argc, char **argv) {
-    if (argc > 1 && strcmp(argv[1], "blank") == 0) {
-        *initial_population = initial_population_blank;
-    }
-    else if (argc > 2 && strcmp(argv[1], "from-forest") == 0) {
-        *initial_population = initial_population_from_forest;
-        strncpy(parameters->forest, argv[2], PATH_SIZE);
-    }
-    else {
-        fprintf(stderr, "[%s: %d] Unknown type of population generation function \"%s\".\n", __FILE__, __LINE__, argv[1]);
+static void parse_population_generator(InitialPopulation *initial_population, InitialPopulationParameters *parameters, int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "blank") == 0) {
+        *initial_population = initial_population_blank;
+    }
+    else if (argc > 2 && strcmp(argv[1], "from-forest") == 0) {
+        *initial_population = initial_population_from_forest;
+        strncpy(parameters->forest, argv[2], PATH_SIZE);
+    }
+    else {
+        fprintf(stderr, "[%s: %d] Unknown type of population generation function \"%s\".\n", __FILE__, __LINE__, argv[1]);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+
+static void parse_max_iteration(unsigned int *max_iteration, int argc, char **argv) {
+    if (argc > 1) {
+        sscanf(argv[1], "%u", max_iteration);
+    }
+}
+
+
+
+static void parse_time_limit(double *time_limit, int argc, char **argv) {
+    if (argc > 1) {
+        sscanf(argv[1], "%lf", time_limit);
+    }
+}
+
+
+
+static void parse_patience(unsigned int *patience, int argc, char **argv) {
+    if (argc > 1) {
+        sscanf(argv[1], "%u", patience);
+    }
+}
+
+
+
+static void parse_patience_delta(double *delta, int argc, char **argv) {
+    if (argc > 1) {
+        sscanf(argv[1], "%lf", delta);
+    }
+}
+
+
+
+static void parse_elitism(unsigned int *elitism, int argc, char **argv) {
+    if (argc > 1) {
+        sscanf(argv[1], "%u", elitism);
+    }
+}
+
+
+
+static void parse_split_search_aggressiveness(double *aggressiveness, int argc, char **argv) {
+    if (argc > 1) {
+        sscanf(argv[1], "%lf", aggressiveness);
+    }
+}
+
+
+
+static void parse_allowed_features(AllowFeatures *allow_feature, unsigned int *n, int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "all") == 0) {
+        *allow_feature = allow_features_all;
+        *n = 0;
+    }
+    else if (argc > 2 && strcmp(argv[1], "uniform") == 0) {
+        *allow_feature = allow_features_uniform;
+        sscanf(argv[2], "%u", n);
+    }
+    else {
+        fprintf(stderr, "[%s: %d] Unknown type of allow features function \"%s\".\n", __FILE__, __LINE__, argv[1]);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+
+static void parse_racing(double *delta, unsigned int *attempts, int argc, char **argv) {
+    if (argc > 2) {
+        sscanf(argv[1], "%lf", delta);
+        sscanf(argv[2], "%u", attempts);
+    }
+    else {
+        fprintf(stderr, "[%s: %d] Racing requires a confidence level and a number of attempts.\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+
+static void parse_sample_schedule(double *fraction, double *growth, int argc, char **argv) {
+    if (argc > 2) {
+        sscanf(argv[1], "%lf", fraction);
+        sscanf(argv[2], "%lf", growth);
+    }
+    else {
+        fprintf(stderr, "[%s: %d] Sample schedule requires an initial fraction and a growth factor.\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+
+static void parse_epsilon_scales(FitnessParameters *fitness_parameters, int argc, char **argv) {
+    unsigned int n = 0, capacity = 16;
+    double *scales;
+    FILE *stream;
+
+    if (argc < 2) {
+        fprintf(stderr, "[%s: %d] Epsilon scales require a path.\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+
+    stream = fopen(argv[1], "r");
+    if (stream == NULL) {
+        fprintf(stderr, "[%s: %d] Cannot open epsilon scales \"%s\".\n", __FILE__, __LINE__, argv[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    scales = (double *) malloc(capacity * sizeof(double));
+    while (fscanf(stream, "%lf", scales + n) == 1) {
+        if (++n == capacity) {
+            capacity *= 2;
+            scales = (double *) realloc(scales, capacity * sizeof(double));
+        }
+    }
+    fclose(stream);
+
+    free(fitness_parameters->linear.epsilon_scales);
+    fitness_parameters->linear.epsilon_scales = scales;
+    fitness_parameters->linear.n_epsilon_scales = n;
+}
+
+
+
+static void parse_duplicates(Duplicates *duplicates, unsigned int *attempts, double *penalty, int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "keep") == 0) {
+        *duplicates = DUPLICATES_KEEP;
+    }
+    else if (argc > 2 && strcmp(argv[1], "reject") == 0) {
+        *duplicates = DUPLICATES_REJECT;
+        sscanf(argv[2], "%u", attempts);
+    }
+    else if (argc > 2 && strcmp(argv[1], "penalize") == 0) {
+        *duplicates = DUPLICATES_PENALIZE;
+        sscanf(argv[2], "%lf", penalty);
+    }
+    else {
+        fprintf(stderr, "[%s: %d] Unknown duplicate policy \"%s\".\n", __FILE__, __LINE__, argc > 1 ? argv[1] : "");
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+
+static void parse_checkpoint(char *path, unsigned int *interval, int argc, char **argv) {
+    if (argc > 2) {
+        strncpy(path, argv[1], PATH_SIZE - 1);
+        path[PATH_SIZE - 1] = '\0';
+        sscanf(argv[2], "%u", interval);
+    }
+    else {
+        fprintf(stderr, "[%s: %d] Checkpoints require a path and an interval.\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+
+static void parse_profile(Status *status, int argc, char **argv) {
+#ifdef PROFILE
+    if (argc < 2) {
+        fprintf(stderr, "[%s: %d] Profiling requires an output path.\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    if (status->profile.stream != NULL) {
+        fclose(status->profile.stream);
+    }
+    status->profile.stream = fopen(argv[1], "w");
+    if (status->profile.stream == NULL) {
+        fprintf(stderr, "[%s: %d] Cannot open profile output \"%s\".\n", __FILE__, __LINE__, argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    status->callback_profile = callback_profile_print;
+#else
+    (void) status;
+    (void) argc;
+    (void) argv;
+    fprintf(stderr, "[%s: %d] Profiling is not available, rebuild with \"make PROFILE=1\".\n", __FILE__, __LINE__);
+    exit(EXIT_FAILURE);
+#endif
+}
+
+
+
+static void parse_seed(unsigned int *seed, int argc, char **argv) {
+    if (argc > 1) {
+        sscanf(argv[1], "%u", seed);
+    }
+}
+
+
+
+/* Options replayed from a checkpoint skip those bound to the original run */
+static void parse_options(Status *status, int argc, char **argv, const unsigned int is_replaying) {
+    int i;
+
+    for (i = 0; i < argc; ++i) {
+        if (strcmp(argv[i], "--resume") == 0) {
+            ++i;
+            continue;
+        }
+        if (is_replaying && is_run_option(argv[i])) {
+            continue;
+        }
+
+        if (strcmp(argv[i], "--fitness") == 0) {
+            parse_fitness(&status->compute_fitness, &status->compute_fitness_batch, &status->fitness_parameters, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--select") == 0) {
+            parse_select(&status->select, &status->tournament_size, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--crossover") == 0) {
+            parse_crossover(&status->crossover, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--mutation") == 0) {
+            parse_mutation(&status->mutate, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--mutation-base-probability") == 0) {
+            parse_mutation_base_probability(&status->base_mutation_probability, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--mutation-probability") == 0) {
+            parse_mutation_probability(&status->mutation_probability, argc - i, argv + 1);
+        }
+        else if (strcmp(argv[i], "--population-initial-size") == 0) {
+            parse_population_initial_size(&status->initial_population_size, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--population-max-size") == 0) {
+            parse_population_max_size(&status->max_population_size, argc - i, argv + i);
+            population_alloc(&status->population, status->max_population_size);
+            population_alloc(&status->population_swap, status->max_population_size);
+        }
+        else if (strcmp(argv[i], "--population-next-size") == 0) {
+            parse_population_next_size(&status->next_population_size, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--population-generator") == 0) {
+            parse_population_generator(&status->initial_population, &status->initial_population_parameters, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--max-iteration") == 0) {
+            parse_max_iteration(&status->max_iteration, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--time-limit") == 0) {
+            parse_time_limit(&status->time_limit, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--patience") == 0) {
+            parse_patience(&status->patience, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--patience-delta") == 0) {
+            parse_patience_delta(&status->patience_delta, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--elitism") == 0) {
+            parse_elitism(&status->elitism, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--split-search-aggressiveness") == 0) {
+            parse_split_search_aggressiveness(&status->split_search_aggressiveness, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--allowed-features") == 0) { 
+            parse_allowed_features(&status->allow_features, &status->n_allowed_features, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--racing") == 0) {
+            parse_racing(&status->racing_delta, &status->racing_attempts, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--sample-schedule") == 0) {
+            parse_sample_schedule(&status->sample_schedule_fraction, &status->sample_schedule_growth, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--epsilon-scales") == 0) {
+            parse_epsilon_scales(&status->fitness_parameters, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--duplicates") == 0) {
+            parse_duplicates(&status->duplicates, &status->duplicate_attempts, &status->duplicate_penalty, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--checkpoint") == 0) {
+            parse_checkpoint(status->checkpoint_path, &status->checkpoint_interval, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--profile") == 0) {
+            parse_profile(status, argc - i, argv + i);
+        }
+        else if (strcmp(argv[i], "--seed") == 0) {
+            parse_seed(&status->seed, argc - i, argv + i);
+            srand(status->seed);
+        }
+    }
+}
+
+
+
+static void parse_resume(Status *status, int argc, char **argv) {
+    unsigned int i, n_options;
+    char **options;
+    FILE *fh;
+
+    if (argc < 2) {
+        fprintf(stderr, "[%s: %d] Resuming requires a checkpoint path.\n", __FILE__, __LINE__);
         exit(EXIT_FAILURE);
     }
-}
-
-
 
-static void parse_max_iteration(unsigned int *max_iteration, int argc, char **argv) {
-    if (argc > 1) {
-        sscanf(argv[1], "%u", max_iteration);
+    fh = fopen(argv[1], "rb");
+    if (fh == NULL) {
+        fprintf(stderr, "[%s: %d] Cannot open checkpoint \"%s\".\n", __FILE__, __LINE__, argv[1]);
+        exit(EXIT_FAILURE);
     }
-}
-
+    options = checkpoint_load_options(fh, &n_options);
+    fclose(fh);
 
+    parse_options(status, n_options, options, 1);
+    options_record(status, n_options, options);
+    strncpy(status->resume_path, argv[1], PATH_SIZE - 1);
+    status->resume_path[PATH_SIZE - 1] = '\0';
 
-static void parse_elitism(unsigned int *elitism, int argc, char **argv) {
-    if (argc > 1) {
-        sscanf(argv[1], "%u", elitism);
+    for (i = 0; i < n_options; ++i) {
+        free(options[i]);
     }
+    free(options);
 }
 
 
 
-static void parse_split_search_aggressiveness(double *aggressiveness, int argc, char **argv) {
-    if (argc > 1) {
-        sscanf(argv[1], "%lf", aggressiveness);
-    }
-}
-
 
+/***********************************************************************
+ * Pre-made functions.
+ **********************************************************************/
 
-static void parse_allowed_features(AllowFeatures *allow_feature, unsigned int *n, int argc, char **argv) {
-    if (argc > 1 && strcmp(argv[1], "all") == 0) {
-        *allow_feature = allow_features_all;
-        *n = 0;
+double fitness_linear(const Individual individual, Status *status) {
+    Performance performance;
+    const double *parameters = status->fitness_parameters.linear.weights;
+    const Perturbation perturbation = linear_perturbation(status->fitness_parameters);
+
+    if (status->admission_threshold > -HUGE_VAL) {
+        double weights[4];
+
+        weights[OUTCOME_ROBUST] = parameters[1] + parameters[3] + parameters[6];
+        weights[OUTCOME_VULNERABLE] = parameters[2] + parameters[3] + parameters[7];
+        weights[OUTCOME_FRAGILE] = parameters[1] + parameters[4] + parameters[8];
+        weights[OUTCOME_BROKEN] = parameters[2] + parameters[4] + parameters[9];
+        status->is_rejected = decision_tree_performance_race(
+            &performance, individual, individual.dataset, perturbation,
+            status->evaluation_order, status->evaluation_size,
+            weights, status->admission_threshold, status->racing_delta
+        );
     }
-    else if (argc > 2 && strcmp(argv[1], "uniform") == 0) {
-        *allow_feature = allow_features_uniform;
-        sscanf(argv[2], "%u", n);
+    else if (status->evaluation_order && status->evaluation_size < individual.dataset.size) {
+        decision_tree_performance_sample(
+            &performance, individual, individual.dataset, perturbation,
+            status->evaluation_order, status->evaluation_size
+        );
     }
     else {
-        fprintf(stderr, "[%s: %d] Unknown type of allow features function \"%s\".\n", __FILE__, __LINE__, argv[1]);
-        exit(EXIT_FAILURE);
+        decision_tree_performance_sample(
+            &performance, individual, individual.dataset, perturbation,
+            NULL, individual.dataset.size
+        );
     }
-}
-
 
-
-static void parse_seed(unsigned int *seed, int argc, char **argv) {
-    if (argc > 1) {
-        sscanf(argv[1], "%u", seed);
-    }
+    return linear_combination(performance, parameters);
 }
 
 
 
+void fitness_linear_batch(double *fitness, const Individual *individuals, const unsigned int n, Status *status) {
+    const double *parameters = status->fitness_parameters.linear.weights;
+    const Perturbation perturbation = linear_perturbation(status->fitness_parameters);
+    Performance *performances;
+    unsigned int i;
 
+    if (n == 0) {
+        return;
+    }
 
-/***********************************************************************
- * Pre-made functions.
- **********************************************************************/
-
-double fitness_linear(const Individual individual, Status *status) {
-    Performance performance;
-    const double *parameters = status->fitness_parameters.linear;
-
-    (void) status;
-    decision_tree_performance(&performance, individual, individual.dataset, parameters[0]);
+    performances = (Performance *) malloc(n * sizeof(Performance));
+    if (status->evaluation_order && status->evaluation_size < individuals[0].dataset.size) {
+        decision_tree_performance_batch(
+            performances, individuals, n, individuals[0].dataset, perturbation,
+            status->evaluation_order, status->evaluation_size
+        );
+    }
+    else {
+        decision_tree_performance_batch(
+            performances, individuals, n, individuals[0].dataset, perturbation,
+            NULL, individuals[0].dataset.size
+        );
+    }
 
-    return parameters[1] * (double) performance.correct / performance.samples
-         + parameters[2] * (double) performance.wrong / performance.samples
-         + parameters[3] * (double) performance.stable / performance.samples
-         + parameters[4] * (double) performance.unstable / performance.samples
-         + parameters[5] * (1.0 - (double) (performance.stable + performance.unstable) / performance.samples)
-         + parameters[6] * (double) performance.robust / performance.samples
-         + parameters[7] * (double) performance.vulnerable / performance.samples
-         + parameters[8] * (double) performance.fragile / performance.samples
-         + parameters[9] * (double) performance.broken / performance.samples;
+    for (i = 0; i < n; ++i) {
+        fitness[i] = linear_combination(performances[i], parameters);
+    }
+    free(performances);
 }
 
 
 
 void crossover_one_point(Individual *offspring, const Individual parent_a, const Individual parent_b, Status *status) {
-    Stack S_parent, S_offspring;
     Node *subtree_a = choose_subtree(parent_a),
-         *subtree_b = choose_subtree(parent_b);
-
-    (void) status;
-    decision_tree_create(offspring, parent_a.dataset);
-
-    stack_create(&S_parent);
-    stack_create(&S_offspring);
-
-    stack_push(S_parent, parent_a.root);
-    stack_push(S_offspring, offspring->root);
-
-    while (!stack_is_empty(S_parent)) {
-        Node *node_parent = stack_pop(S_parent),
-             *node_offspring = stack_pop(S_offspring);
-        SplitResult split_result;
-
-        if (node_parent == subtree_a && node_parent->tree != subtree_b->tree) {
-            node_parent = subtree_b;
-        }
-
-        if (node_is_leaf(*node_parent)) {
-            continue;
-        }
-
-        split_result = node_split(node_offspring, node_parent->feature, node_parent->threshold);
-        if (split_result == SPLIT_BOTH) {
-            stack_push(S_offspring, node_offspring->right);
-            stack_push(S_offspring, node_offspring->left);
+         *subtree_b = choose_subtree(parent_b),
+         *graft;
 
-            stack_push(S_parent, node_parent->right);
-            stack_push(S_parent, node_parent->left);
-        }
-        else {
-            stack_push(S_offspring, node_offspring);
-            if (split_result == SPLIT_LEFT) {
-                stack_push(S_parent, node_parent->left);
-            }
-            else {
-                stack_push(S_parent, node_parent->left);
-            }
-        }
+    decision_tree_copy(offspring, parent_a, &status->pool);
+    if (parent_a.root == parent_b.root) {
+        return;
     }
 
-    stack_delete(&S_parent);
-    stack_delete(&S_offspring);
+    graft = corresponding_node(subtree_a, *offspring);
+    node_prune(graft);
+    graft_subtree(graft, subtree_b);
 }
 
 
@@ -421,6 +1339,7 @@ void mutation_grow(Individual *individual, Status *status) {
     buffer = (double *) malloc(2 * individual->dataset.n_labels * sizeof(double));
     split_trial(&feature, &threshold, *node, buffer, status);
     node_split(node, feature, threshold);
+    PROFILE_ADD(status, nodes_created, node_is_leaf(*node) ? 0 : 2);
     free(buffer);
 }
 
@@ -448,6 +1367,7 @@ void mutation_z(Individual *individual, Status *status) {
     buffer = (double *) malloc(2 * individual->dataset.n_labels * sizeof(double));
     split_trial(&feature, &threshold, *node, buffer, status);
     node_split(node, feature, threshold);
+    PROFILE_ADD(status, nodes_created, node_is_leaf(*node) ? 0 : 2);
     free(buffer);
 }
 
@@ -516,25 +1436,64 @@ Individual select_uniform(const Population population, Status *status) {
 
 
 Individual select_roulette_wheel(const Population population, Status *status) {
-    unsigned int i;
-    double sum = 0.0,
-           p = (double) rand() / RAND_MAX;
+    const double sum = status->selection_cumulative[population.size - 1];
 
-    (void) status;
-    for (i = 0; i < population.size; ++i) {
-        sum += population.fitness[i];
-    }
     if (sum == 0.0) {
-        return population.individuals[0];
+        return population.individuals[rand() % population.size];
     }
 
-    for (i = 0; i < population.size; ++i) {
-        if (p >= population.fitness[i] / sum) {
-            return population.individuals[i];
+    return population.individuals[selection_spin(status->selection_cumulative, population.size, sum * rand() / (RAND_MAX + 1.0))];
+}
+
+
+
+Individual select_stochastic_universal(const Population population, Status *status) {
+    const double sum = status->selection_cumulative[population.size - 1],
+                 step = sum / population.size;
+    unsigned int i;
+
+    /* Spins once for a whole round of equally spaced pointers, then
+     * hands them out in random order */
+    if (status->n_selection_picks == 0) {
+        if (sum == 0.0) {
+            shuffle(status->selection_picks, population.size);
+        }
+        else {
+            double pointer = step * rand() / (RAND_MAX + 1.0);
+            unsigned int j = 0;
+
+            for (i = 0; i < population.size; ++i, pointer += step) {
+                while (j < population.size - 1 && status->selection_cumulative[j] <= pointer) {
+                    ++j;
+                }
+                status->selection_picks[i] = j;
+            }
+            for (i = population.size; i > 1; --i) {
+                const unsigned int k = rand() % i,
+                                   buffer = status->selection_picks[i - 1];
+                status->selection_picks[i - 1] = status->selection_picks[k];
+                status->selection_picks[k] = buffer;
+            }
+        }
+        status->n_selection_picks = population.size;
+    }
+
+    return population.individuals[status->selection_picks[--status->n_selection_picks]];
+}
+
+
+
+Individual select_tournament(const Population population, Status *status) {
+    unsigned int i, best = rand() % population.size;
+
+    for (i = 1; i < status->tournament_size; ++i) {
+        const unsigned int challenger = rand() % population.size;
+        if (population.fitness[challenger] > population.fitness[best]) {
+            best = challenger;
         }
     }
 
-    return population.individuals[0];
+    return population.individuals[best];
 }
 
 
@@ -598,76 +1557,327 @@ void callback_status_print(Status *status) {
 
 
 
+#ifdef PROFILE
+void callback_profile_print(Status *status) {
+    static const char *names[PROFILE_N_PHASES] = {
+        "generation", "selection", "crossover", "mutation", "fitness", "duplicates", "replacement"
+    };
+    const struct profile *profile = &status->profile;
+    unsigned int i;
+
+    fprintf(profile->stream, "{\"iteration\": %u", status->current_iteration + 1);
+    for (i = 0; i < PROFILE_N_PHASES; ++i) {
+        fprintf(profile->stream, ", \"%s\": {\"seconds\": %.6f, \"calls\": %lu}",
+                names[i], stopwatch_get_elapsed_time_seconds(profile->stopwatches[i]), profile->calls[i]);
+    }
+    fprintf(profile->stream, ", \"nodes_created\": %lu, \"splits_scored\": %lu, \"samples_traversed\": %lu}\n",
+            profile->nodes_created, profile->splits_scored, profile->samples_traversed);
+    fflush(profile->stream);
+}
+#endif
+
+
+
 /***********************************************************************
  * Pubic functions.
  **********************************************************************/
 
 DecisionTree ga_train(Status *status, const Dataset training_set) {
-    unsigned int i;
+    /* Default batch computes default fitness only, so another fitness
+     * installed alone is evaluated one tree at a time */
+    const unsigned int is_batched = status->compute_fitness_batch != NULL && status->racing_attempts == 0
+        && (status->compute_fitness == DEFAULT_FITNESS || status->compute_fitness_batch != DEFAULT_FITNESS_BATCH);
+    unsigned int i, j, k, n_offspring, n_unique, capacity, first_iteration = 0;
+    double elapsed_time = 0.0, iteration_time = 0.0;
+    Stopwatch stopwatch;
+    Individual *offspring, *unique;
+    double *offspring_fitness, *offspring_raw_fitness, *unique_fitness;
+    unsigned long *offspring_fingerprints, *table_keys;
+    unsigned int *offspring_twins, *table_codes;
+    struct ranking *ranking;
+
+    if (status->fitness_parameters.linear.epsilon_scales != NULL
+        && status->fitness_parameters.linear.n_epsilon_scales != training_set.space_size) {
+        fprintf(stderr, "[%s: %d] Expected %u epsilon scales, found %u.\n", __FILE__, __LINE__,
+                training_set.space_size, status->fitness_parameters.linear.n_epsilon_scales);
+        exit(EXIT_FAILURE);
+    }
+
+    stopwatch_create(&stopwatch);
+
+    /* Restores a checkpoint, or starts from scratch */
+    if (status->resume_path[0] != '\0') {
+        FILE *fh = fopen(status->resume_path, "rb");
+        unsigned int n_options;
+        char **options;
 
-    /* Choses features */
-    if (status->n_allowed_features == 0) {
-        status->n_allowed_features = training_set.space_size;
+        if (fh == NULL) {
+            fprintf(stderr, "[%s: %d] Cannot open checkpoint \"%s\".\n", __FILE__, __LINE__, status->resume_path);
+            exit(EXIT_FAILURE);
+        }
+        options = checkpoint_load_options(fh, &n_options);
+        for (i = 0; i < n_options; ++i) {
+            free(options[i]);
+        }
+        free(options);
+        first_iteration = checkpoint_load_state(fh, status, training_set);
+        fclose(fh);
+
+        /* Racing or schedule may be enabled only on resume */
+        if (status->evaluation_order == NULL) {
+            status->evaluation_order = evaluation_order_create(status, training_set);
+        }
     }
-    status->allowed_features = (unsigned int *) malloc(status->n_allowed_features * sizeof(unsigned int));
-    status->allow_features(status->allowed_features, training_set.space_size, status);
+    else {
+        /* Choses features */
+        if (status->n_allowed_features == 0) {
+            status->n_allowed_features = training_set.space_size;
+        }
+        status->allowed_features = (unsigned int *) malloc(status->n_allowed_features * sizeof(unsigned int));
+        status->allow_features(status->allowed_features, training_set.space_size, status);
+
+        /* Orders samples for racing and progressive evaluation */
+        status->current_iteration = 0;
+        status->evaluation_size = training_set.size;
+        status->evaluation_order = evaluation_order_create(status, training_set);
+        if (status->sample_schedule_fraction < 1.0) {
+            status->evaluation_size = scheduled_sample_size(status, training_set.size);
+        }
 
-    /* Generates initial population */
-    status->initial_population(&status->population, training_set, status);
+        /* Generates initial population */
+        status->initial_population(&status->population, training_set, status);
+        memcpy(status->population.raw_fitness, status->population.fitness, status->population.size * sizeof(double));
+    }
+    for (i = 0; i < status->population.size; ++i) {
+        status->population.fingerprints[i] = decision_tree_fingerprint(status->population.individuals[i]);
+    }
+    offspring = (Individual *) malloc(status->max_population_size * sizeof(Individual));
+    offspring_fitness = (double *) malloc(status->max_population_size * sizeof(double));
+    offspring_raw_fitness = (double *) malloc(status->max_population_size * sizeof(double));
+    offspring_fingerprints = (unsigned long *) malloc(status->max_population_size * sizeof(unsigned long));
+    offspring_twins = (unsigned int *) malloc(status->max_population_size * sizeof(unsigned int));
+    unique = (Individual *) malloc(status->max_population_size * sizeof(Individual));
+    unique_fitness = (double *) malloc(status->max_population_size * sizeof(double));
+    ranking = (struct ranking *) malloc(status->max_population_size * sizeof(struct ranking));
+
+    /* Fingerprint table of current individuals and offspring */
+    for (capacity = 1; capacity < 4 * status->max_population_size; capacity *= 2);
+    table_keys = (unsigned long *) malloc(capacity * sizeof(unsigned long));
+    table_codes = (unsigned int *) malloc(capacity * sizeof(unsigned int));
 
     /* Start */
     if (status->callback_start) {
         status->callback_start(status);
     }
 
-    for (status->current_iteration = 0; status->current_iteration < status->max_iteration; ++status->current_iteration) {
+    for (status->current_iteration = first_iteration; status->current_iteration < status->max_iteration; ++status->current_iteration) {
         const unsigned int next_population_size = status->next_population_size(status);
+        const unsigned int evaluation_size = scheduled_sample_size(status, training_set.size);
+        double admission_threshold;
         Population population_buffer;
 
+        /* Random numbers depend only on seed and iteration, so that a
+         * resumed run makes the same choices */
+        srand(status->seed + GENERATION_SEED_STRIDE * (status->current_iteration + 1));
+#ifdef PROFILE
+        profile_reset(&status->profile);
+        PROFILE_START(status, PROFILE_GENERATION);
+#endif
+
+        /* Re-scores current individuals when evaluation sample grows */
+        if (status->evaluation_order && evaluation_size != status->evaluation_size) {
+            status->evaluation_size = evaluation_size;
+            population_rescore(&status->population, status);
+        }
+        admission_threshold = worst_fitness(status->population);
+        PROFILE_START(status, PROFILE_SELECTION);
+        selection_prepare(status);
+        PROFILE_STOP(status, PROFILE_SELECTION);
+
         if (status->callback_before_iter) {
             status->callback_before_iter(status);
         }
 
-        for (i = 0;  i < status->elitism; ++i) {
-            status->population_swap.individuals[i] = status->population.individuals[i];
-            status->population_swap.fitness[i] = status->population.fitness[i];
-            status->population_swap.size = i + 1;
+        /* Indexes current individuals by fingerprint */
+        PROFILE_START(status, PROFILE_DUPLICATES);
+        for (i = 0; i < capacity; ++i) {
+            table_codes[i] = NO_TWIN;
         }
-        for (i = status->elitism; i < next_population_size; ++i) {
-            const Individual parent_a = status->select(status->population, status),
-                             parent_b = status->select(status->population, status);
-            const double mutation_probability = status->mutation_probability(status->base_mutation_probability, status);
-            Individual offspring;
-            double fitness;
-            unsigned int j;
-
-            crossover_one_point(&offspring, parent_a, parent_b, status);
-            if ((double) rand() / RAND_MAX < mutation_probability) {
-                status->mutate(&offspring, status);
+        for (i = 0; i < status->population.size; ++i) {
+            const unsigned int slot = fingerprint_slot(table_keys, table_codes, capacity, status->population.fingerprints[i]);
+            if (table_codes[slot] == NO_TWIN) {
+                table_keys[slot] = status->population.fingerprints[i];
+                table_codes[slot] = i;
             }
-            fitness = status->compute_fitness(offspring, status);
+        }
+        PROFILE_STOP(status, PROFILE_DUPLICATES);
+
+        /* Generates offspring; racing needs to evaluate them one by
+         * one, otherwise they are evaluated together. Duplicates of
+         * an existing tree are never evaluated */
+        n_offspring = next_population_size > status->elitism ? next_population_size - status->elitism : 0;
+        n_unique = 0;
+        status->n_duplicates = 0;
+        for (i = 0; i < n_offspring; ++i) {
+            unsigned int attempt = 0, duplicate_attempt = 0, slot;
+
+            while (1) {
+                breed(offspring + i, status);
+                PROFILE_START(status, PROFILE_DUPLICATES);
+                offspring_fingerprints[i] = decision_tree_fingerprint(offspring[i]);
+                slot = fingerprint_slot(table_keys, table_codes, capacity, offspring_fingerprints[i]);
+                offspring_twins[i] = table_codes[slot];
+                if (offspring_twins[i] != NO_TWIN) {
+                    const unsigned int twin = offspring_twins[i];
+                    const Individual twin_tree = twin < status->population.size
+                        ? status->population.individuals[twin]
+                        : offspring[twin - status->population.size];
+
+                    /* Fingerprints may collide, so trees are compared too */
+                    if (!decision_tree_is_equal(offspring[i], twin_tree)) {
+                        offspring_twins[i] = NO_TWIN;
+                    }
+                }
+                PROFILE_STOP(status, PROFILE_DUPLICATES);
+                if (offspring_twins[i] != NO_TWIN) {
+                    if (status->duplicates == DUPLICATES_REJECT && duplicate_attempt < status->duplicate_attempts) {
+                        decision_tree_delete(offspring[i]);
+                        ++duplicate_attempt;
+                        continue;
+                    }
+                    break;
+                }
+                if (is_batched) {
+                    break;
+                }
 
-            for (j = 0; j < i; ++j) {
-                if (status->population_swap.fitness[j] <= fitness) {
+                status->admission_threshold = attempt < status->racing_attempts ? admission_threshold : -HUGE_VAL;
+                status->is_rejected = 0;
+                PROFILE_START(status, PROFILE_FITNESS);
+                offspring_fitness[i] = status->compute_fitness(offspring[i], status);
+                PROFILE_STOP(status, PROFILE_FITNESS);
+                PROFILE_ADD(status, samples_traversed, status->evaluation_size);
+                if (!status->is_rejected) {
                     break;
                 }
+
+                decision_tree_delete(offspring[i]);
+                ++attempt;
+            }
+            status->admission_threshold = -HUGE_VAL;
+
+            if (offspring_twins[i] != NO_TWIN) {
+                ++status->n_duplicates;
+                continue;
+            }
+            if (table_codes[slot] == NO_TWIN) {
+                table_keys[slot] = offspring_fingerprints[i];
+                table_codes[slot] = status->population.size + i;
+            }
+            if (is_batched) {
+                unique[n_unique++] = offspring[i];
+            }
+        }
+        if (is_batched) {
+            PROFILE_START(status, PROFILE_FITNESS);
+            status->compute_fitness_batch(unique_fitness, unique, n_unique, status);
+            PROFILE_STOP(status, PROFILE_FITNESS);
+            PROFILE_ADD(status, samples_traversed, (unsigned long) n_unique * status->evaluation_size);
+            for (i = 0, j = 0; i < n_offspring; ++i) {
+                if (offspring_twins[i] == NO_TWIN) {
+                    offspring_fitness[i] = unique_fitness[j++];
+                }
+            }
+        }
+
+        /* Twins are always evaluated, so duplicates copy their fitness;
+         * penalties apply to the unpenalized one, as twins may be
+         * penalized duplicates themselves */
+        for (i = 0; i < n_offspring; ++i) {
+            const unsigned int twin = offspring_twins[i];
+
+            if (twin == NO_TWIN) {
+                offspring_raw_fitness[i] = offspring_fitness[i];
+                continue;
+            }
+            offspring_raw_fitness[i] = twin < status->population.size
+                ? status->population.raw_fitness[twin]
+                : offspring_fitness[twin - status->population.size];
+            offspring_fitness[i] = offspring_raw_fitness[i];
+            if (status->duplicates == DUPLICATES_PENALIZE) {
+                offspring_fitness[i] -= status->duplicate_penalty;
+            }
+        }
+
+        /* Ranks offspring, latest first among ties, and merges them
+         * with elites into the next population */
+        PROFILE_START(status, PROFILE_REPLACEMENT);
+        for (i = 0; i < n_offspring; ++i) {
+            ranking[i].fitness = offspring_fitness[i];
+            ranking[i].index = i;
+        }
+        qsort(ranking, n_offspring, sizeof(struct ranking), compare_ranking);
+        for (i = 0, j = 0, k = 0; i < status->elitism + n_offspring; ++i) {
+            if (k < n_offspring && (j == status->elitism || ranking[k].fitness >= status->population.fitness[j])) {
+                const unsigned int index = ranking[k++].index;
+                status->population_swap.individuals[i] = offspring[index];
+                status->population_swap.fitness[i] = offspring_fitness[index];
+                status->population_swap.raw_fitness[i] = offspring_raw_fitness[index];
+                status->population_swap.fingerprints[i] = offspring_fingerprints[index];
+            }
+            else {
+                status->population_swap.individuals[i] = status->population.individuals[j];
+                status->population_swap.fitness[i] = status->population.fitness[j];
+                status->population_swap.raw_fitness[i] = status->population.raw_fitness[j];
+                status->population_swap.fingerprints[i] = status->population.fingerprints[j];
+                ++j;
             }
-            memmove(status->population_swap.individuals + j + 1, status->population_swap.individuals + j, (i - j) * sizeof(Individual));
-            memmove(status->population_swap.fitness + j + 1, status->population_swap.fitness + j, (i - j) * sizeof(double));
-            status->population_swap.individuals[j] = offspring;
-            status->population_swap.fitness[j] = fitness;
-            status->population_swap.size = i + 1;
         }
+        status->population_swap.size = status->elitism + n_offspring;
         population_buffer = status->population;
         status->population = status->population_swap;
         status->population_swap = population_buffer;
         for (i = status->elitism; i < status->population_swap.size; ++i) {
             decision_tree_delete(status->population_swap.individuals[i]);
         }
+        PROFILE_STOP(status, PROFILE_REPLACEMENT);
 
         if (status->callback_after_iter) {
             status->callback_after_iter(status);
         }
+#ifdef PROFILE
+        PROFILE_STOP(status, PROFILE_GENERATION);
+        if (status->callback_profile) {
+            status->callback_profile(status);
+        }
+#endif
+
+        /* Tracks convergence before checkpointing, so that a resumed
+         * run stops when this one would have */
+        if (status->population.fitness[0] > status->best_fitness + status->patience_delta) {
+            status->best_fitness = status->population.fitness[0];
+            status->n_stalled = 0;
+        }
+        else {
+            ++status->n_stalled;
+        }
+
+        if (status->checkpoint_interval > 0 && (status->current_iteration + 1) % status->checkpoint_interval == 0) {
+            checkpoint(status, status->current_iteration + 1);
+        }
+
+        /* Stops early on convergence, or when another iteration as long
+         * as this one would not fit in the time budget */
+        stopwatch_pause(stopwatch);
+        iteration_time = stopwatch_get_elapsed_time_seconds(stopwatch) - elapsed_time;
+        elapsed_time = stopwatch_get_elapsed_time_seconds(stopwatch);
+        stopwatch_start(stopwatch);
+        if (status->patience > 0 && status->n_stalled >= status->patience) {
+            break;
+        }
+        if (status->time_limit > 0.0 && elapsed_time + iteration_time > status->time_limit) {
+            break;
+        }
     }
 
     /* End */
@@ -676,7 +1886,21 @@ DecisionTree ga_train(Status *status, const Dataset training_set) {
     }
 
     /* Frees memory */
+    checkpoint_wait(status);
+    stopwatch_delete(&stopwatch);
+    free(offspring);
+    free(offspring_fitness);
+    free(offspring_raw_fitness);
+    free(offspring_fingerprints);
+    free(offspring_twins);
+    free(unique);
+    free(unique_fitness);
+    free(ranking);
+    free(table_keys);
+    free(table_codes);
     free(status->allowed_features);
+    free(status->evaluation_order);
+    status->evaluation_order = NULL;
 
     return status->population.individuals[0];
 }
@@ -684,31 +1908,47 @@ DecisionTree ga_train(Status *status, const Dataset training_set) {
 
 
 void ga_status_init(Status *status) {
+#ifdef PROFILE
+    unsigned int i;
+
+#endif
     status->population.individuals = NULL;
     status->population.fitness = NULL;
+    status->population.raw_fitness = NULL;
+    status->population.fingerprints = NULL;
     population_alloc(&status->population, DEFAULT_POPULATION_MAX_SIZE);
     status->population.size = 0;
 
     status->population_swap.individuals = NULL;
     status->population_swap.fitness = NULL;
+    status->population_swap.raw_fitness = NULL;
+    status->population_swap.fingerprints = NULL;
     population_alloc(&status->population_swap, DEFAULT_POPULATION_MAX_SIZE);
     status->population_swap.size = 0;
 
     status->current_iteration = 0;
 
     status->compute_fitness = DEFAULT_FITNESS;
-    status->fitness_parameters.linear[0] = 0.0;
-    status->fitness_parameters.linear[1] = 1.0;
-    status->fitness_parameters.linear[2] = 0.0;
-    status->fitness_parameters.linear[3] = 0.0;
-    status->fitness_parameters.linear[4] = 0.0;
-    status->fitness_parameters.linear[5] = 0.0;
-    status->fitness_parameters.linear[6] = 0.0;
-    status->fitness_parameters.linear[7] = 0.0;
-    status->fitness_parameters.linear[8] = 0.0;
-    status->fitness_parameters.linear[9] = 0.0;
+    status->compute_fitness_batch = DEFAULT_FITNESS_BATCH;
+    status->fitness_parameters.linear.weights[0] = 0.0;
+    status->fitness_parameters.linear.weights[1] = 1.0;
+    status->fitness_parameters.linear.weights[2] = 0.0;
+    status->fitness_parameters.linear.weights[3] = 0.0;
+    status->fitness_parameters.linear.weights[4] = 0.0;
+    status->fitness_parameters.linear.weights[5] = 0.0;
+    status->fitness_parameters.linear.weights[6] = 0.0;
+    status->fitness_parameters.linear.weights[7] = 0.0;
+    status->fitness_parameters.linear.weights[8] = 0.0;
+    status->fitness_parameters.linear.weights[9] = 0.0;
+    status->fitness_parameters.linear.epsilon_scales = NULL;
+    status->fitness_parameters.linear.n_epsilon_scales = 0;
+    status->fitness_parameters.linear.boxes = NULL;
 
     status->select = DEFAULT_SELECT;
+    status->selection_cumulative = NULL;
+    status->selection_picks = NULL;
+    status->n_selection_picks = 0;
+    status->tournament_size = DEFAULT_TOURNAMENT_SIZE;
     status->crossover = DEFAULT_CROSSOVER;
     status->mutate = DEFAULT_MUTATION;
     status->base_mutation_probability = DEFAULT_BASE_MUTATION_PROBABILITY;
@@ -718,14 +1958,48 @@ void ga_status_init(Status *status) {
     status->next_population_size = DEFAULT_POPULATION_NEXT_SIZE;
     status->initial_population = DEFAULT_POPULATION_GENERATOR;
     status->max_iteration = DEFAULT_MAX_ITERATION;
+    status->time_limit = DEFAULT_TIME_LIMIT;
+    status->patience = DEFAULT_PATIENCE;
+    status->patience_delta = DEFAULT_PATIENCE_DELTA;
+    status->best_fitness = -HUGE_VAL;
+    status->n_stalled = 0;
     status->elitism = DEFAULT_ELITISM;
     status->split_search_aggressiveness = DEFAULT_SPLIT_SEARCH_AGGRESSIVENESS;
     status->allow_features = DEFAULT_ALLOW_FEATURES;
+    status->allowed_features = NULL;
+    status->n_allowed_features = 0;
+    status->racing_delta = DEFAULT_RACING_DELTA;
+    status->racing_attempts = DEFAULT_RACING_ATTEMPTS;
+    status->sample_schedule_fraction = DEFAULT_SAMPLE_SCHEDULE_FRACTION;
+    status->sample_schedule_growth = DEFAULT_SAMPLE_SCHEDULE_GROWTH;
+    status->evaluation_order = NULL;
+    status->evaluation_size = 0;
+    status->admission_threshold = -HUGE_VAL;
+    status->is_rejected = 0;
+    status->duplicates = DEFAULT_DUPLICATES;
+    status->duplicate_attempts = 0;
+    status->duplicate_penalty = 0.0;
+    status->n_duplicates = 0;
+    tree_pool_create(&status->pool);
     status->data = NULL;
     status->callback_start = NULL;
     status->callback_before_iter = NULL;
     status->callback_after_iter = NULL;
     status->callback_end = NULL;
+#ifdef PROFILE
+    for (i = 0; i < PROFILE_N_PHASES; ++i) {
+        stopwatch_create(status->profile.stopwatches + i);
+    }
+    profile_reset(&status->profile);
+    status->profile.stream = NULL;
+    status->callback_profile = NULL;
+#endif
+    status->options = NULL;
+    status->n_options = 0;
+    status->checkpoint_path[0] = '\0';
+    status->checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL;
+    status->checkpoint_writer = 0;
+    status->resume_path[0] = '\0';
     status->seed = DEFAULT_SEED;
     srand(status->seed);
 }
@@ -739,10 +2013,32 @@ void ga_status_clear(Status *status) {
         decision_tree_delete(status->population.individuals[i]);
     }
 
+    tree_pool_delete(&status->pool);
+
+    free(status->fitness_parameters.linear.epsilon_scales);
+    free(status->selection_cumulative);
+    free(status->selection_picks);
     free(status->population.individuals);
     free(status->population.fitness);
     free(status->population_swap.individuals);
     free(status->population_swap.fitness);
+    free(status->population.raw_fitness);
+    free(status->population_swap.raw_fitness);
+    free(status->population.fingerprints);
+    free(status->population_swap.fingerprints);
+    for (i = 0; i < status->n_options; ++i) {
+        free(status->options[i]);
+    }
+    free(status->options);
+
+#ifdef PROFILE
+    for (i = 0; i < PROFILE_N_PHASES; ++i) {
+        stopwatch_delete(status->profile.stopwatches + i);
+    }
+    if (status->profile.stream != NULL) {
+        fclose(status->profile.stream);
+    }
+#endif
 }
 
 
@@ -750,56 +2046,15 @@ void ga_status_clear(Status *status) {
 void ga_parse_options(Status *status, int argc, char *argv[]) {
     int i;
 
-    for (i = 0; i < argc; ++i) {
-        if (strcmp(argv[i], "--fitness") == 0) {
-            parse_fitness(&status->compute_fitness, &status->fitness_parameters, argc - i, argv + i);
-        }
-        else if (strcmp(argv[i], "--select") == 0) {
-            parse_select(&status->select, argc - i, argv + i);
-        }
-        else if (strcmp(argv[i], "--crossover") == 0) {
-            parse_crossover(&status->crossover, argc - i, argv + i);
-        }
-        else if (strcmp(argv[i], "--mutation") == 0) {
-            parse_mutation(&status->mutate, argc - i, argv + i);
-        }
-        else if (strcmp(argv[i], "--mutation-base-probability") == 0) {
-            parse_mutation_base_probability(&status->base_mutation_probability, argc - i, argv + i);
-        }
-        else if (strcmp(argv[i], "--mutation-probability") == 0) {
-            parse_mutation_probability(&status->mutation_probability, argc - i, argv + 1);
-        }
-        else if (strcmp(argv[i], "--population-initial-size") == 0) {
-            parse_population_initial_size(&status->initial_population_size, argc - i, argv + i);
-        }
-        else if (strcmp(argv[i], "--population-max-size") == 0) {
-            parse_population_max_size(&status->max_population_size, argc - i, argv + i);
-            population_alloc(&status->population, status->max_population_size);
-            population_alloc(&status->population_swap, status->max_population_size);
-        }
-        else if (strcmp(argv[i], "--population-next-size") == 0) {
-            parse_population_next_size(&status->next_population_size, argc - i, argv + i);
-        }
-        else if (strcmp(argv[i], "--population-generator") == 0) {
-            parse_population_generator(&status->initial_population, &status->initial_population_parameters, argc - i, argv + i);
-        }
-        else if (strcmp(argv[i], "--max-iteration") == 0) {
-            parse_max_iteration(&status->max_iteration, argc - i, argv + i);
-        }
-        else if (strcmp(argv[i], "--elitism") == 0) {
-            parse_elitism(&status->elitism, argc - i, argv + i);
-        }
-        else if (strcmp(argv[i], "--split-search-aggressiveness") == 0) {
-            parse_split_search_aggressiveness(&status->split_search_aggressiveness, argc - i, argv + i);
-        }
-        else if (strcmp(argv[i], "--allowed-features") == 0) { 
-            parse_allowed_features(&status->allow_features, &status->n_allowed_features, argc - i, argv + i);
-        }
-        else if (strcmp(argv[i], "--seed") == 0) {
-            parse_seed(&status->seed, argc - i, argv + i);
-            srand(status->seed);
+    /* Options of a resumed run come first, so that new ones override them */
+    for (i = 0; i < argc - 1; ++i) {
+        if (strcmp(argv[i], "--resume") == 0) {
+            parse_resume(status, argc - i, argv + i);
         }
     }
+
+    parse_options(status, argc, argv, 0);
+    options_record(status, argc, argv);
 }
 
 
@@ -809,6 +2064,7 @@ void ga_status_print(FILE *fh, const Status status) {
 
     fprintf(fh, "Iteration %u / %u\n", status.current_iteration + 1, status.max_iteration);
     fprintf(fh, "Population size: %u / %u\n", status.population.size, status.max_population_size);
+    fprintf(fh, "Distinct individuals: %u / %u (%u duplicate offspring)\n", distinct_individuals(status.population), status.population.size, status.n_duplicates);
     fprintf(fh, "Fitness: [%.2g", status.population.fitness[0]);
     for (i = 1; i < status.population.size; ++i) {
         fprintf(fh, ", %.2g", status.population.fitness[i]);
@@ -827,7 +2083,9 @@ void ga_options_print(FILE *fh) {
 
     fprintf(fh, "  %-*s Criterion used to choose parents for crossover\n", name_length, "--select");
     fprintf(fh, "      %-*s Choses a parent with a uniformally distributed probability\n", option_length, "uniform");
-    fprintf(fh, "      %-*s Uses standard Roulette Wheel algorithm\n", option_length, "roulette-wheel");
+    fprintf(fh, "      %-*s Choses a parent with probability proportional to its (non-negative) fitness\n", option_length, "roulette-wheel");
+    fprintf(fh, "      %-*s Like roulette-wheel, with equally spaced pointers to reduce sampling noise\n", option_length, "stochastic-universal");
+    fprintf(fh, "      %-*s Choses the fittest of k uniformally drawn individuals\n", option_length, "tournament k");
 
     fprintf(fh, "  %-*s Crossover function\n", name_length, "--crossover");
     fprintf(fh, "      %-*s Substitutes a subtree from first parent with a subtree from second parent\n", option_length, "one-point");
@@ -856,6 +2114,12 @@ void ga_options_print(FILE *fh) {
 
     fprintf(fh, "  %-*s Maximum number of iterations for genetic algorithm\n", name_length, "--max-iteration n");
 
+    fprintf(fh, "  %-*s Stops before wall-clock time in seconds would exceed t, 0 for no limit\n", name_length, "--time-limit t");
+
+    fprintf(fh, "  %-*s Stops when best fitness has not improved for n iterations, 0 to never stop early\n", name_length, "--patience n");
+
+    fprintf(fh, "  %-*s Smallest gain in best fitness which counts as an improvement for --patience\n", name_length, "--patience-delta d");
+
     fprintf(fh, "  %-*s Number of best individual to copy to next iteration\n", name_length, "--elitism n");
 
     fprintf(fh, "  %-*s Fraction of splits to consider during split generation, in [0; 1]\n", name_length, "--split-search-aggressiveness p");
@@ -864,5 +2128,22 @@ void ga_options_print(FILE *fh) {
     fprintf(fh, "      %-*s Uses every feature\n", option_length, "all");
     fprintf(fh, "      %-*s Randomly choses n features from a uniform distribution\n", option_length, "uniform n");
 
+    fprintf(fh, "  %-*s Stops evaluating offspring which cannot beat the worst individual (with confidence 1 - delta, exact bound if delta is 0), generating them again up to n times\n", name_length, "--racing delta n");
+
+    fprintf(fh, "  %-*s Evaluates fitness on a stratified sample of fraction p of the training set, growing by factor g every iteration\n", name_length, "--sample-schedule p g");
+
+    fprintf(fh, "  %-*s Scales fitness magnitude per feature, reading one factor per feature from path\n", name_length, "--epsilon-scales path");
+
+    fprintf(fh, "  %-*s Handling of offspring identical to an existing tree, which are never evaluated\n", name_length, "--duplicates");
+    fprintf(fh, "      %-*s Keeps them with the fitness of their twin\n", option_length, "keep");
+    fprintf(fh, "      %-*s Breeds them again up to n times\n", option_length, "reject n");
+    fprintf(fh, "      %-*s Keeps them with the fitness of their twin minus p\n", option_length, "penalize p");
+
+    fprintf(fh, "  %-*s Writes population and state to path every n iterations, in background\n", name_length, "--checkpoint path n");
+
+    fprintf(fh, "  %-*s Continues the run saved in a checkpoint, with its options unless given again (except --checkpoint and --profile)\n", name_length, "--resume path");
+
+    fprintf(fh, "  %-*s Writes per-iteration timings and counters to path as JSON lines (requires make PROFILE=1)\n", name_length, "--profile path");
+
     fprintf(fh, "  %-*s Seed for random number generation\n", name_length, "--seed n");
 }
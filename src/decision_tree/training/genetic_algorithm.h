@@ -4,6 +4,10 @@
 #include <stdio.h>
 
 #include "../decision_tree.h"
+#include "../../geometry/hyperrectangle.h"
+#ifdef PROFILE
+#include "../../data_structures/stopwatch.h"
+#endif
 
 #define PATH_SIZE 1024
 
@@ -16,6 +20,7 @@ typedef struct status Status;
 typedef void (*InitialPopulation)(Population *population, const Dataset training_set, Status *status);
 typedef unsigned int (*NextPopulationSize)(Status *status);
 typedef double (*Fitness)(const Individual individual, Status *status);
+typedef void (*FitnessBatch)(double *fitness, const Individual *individuals, const unsigned int n, Status *status);
 typedef double (*MutationProbability)(const double base_mutation_probability, Status *status);
 typedef void (*Mutation)(Individual *individual, Status *status);
 typedef void (*Crossover)(Individual *offspring, const Individual parent_a, const Individual parent_b, Status *status);
@@ -27,12 +32,55 @@ typedef void (*Callback)(Status *status);
 struct population {
     Individual *individuals;
     double *fitness;
+    double *raw_fitness;             /* Fitness before duplicate penalties */
+    unsigned long *fingerprints;
     unsigned int size;
 };
 
 
+enum duplicates {
+    DUPLICATES_KEEP,
+    DUPLICATES_REJECT,
+    DUPLICATES_PENALIZE
+};
+
+
+typedef enum duplicates Duplicates;
+
+
+#ifdef PROFILE
+/* Phases of an iteration timed by profiling builds (make PROFILE=1) */
+enum profile_phase {
+    PROFILE_GENERATION,
+    PROFILE_SELECTION,
+    PROFILE_CROSSOVER,
+    PROFILE_MUTATION,
+    PROFILE_FITNESS,
+    PROFILE_DUPLICATES,
+    PROFILE_REPLACEMENT,
+    PROFILE_N_PHASES
+};
+
+
+/* Per-iteration profile, reset at the start of every iteration */
+struct profile {
+    Stopwatch stopwatches[PROFILE_N_PHASES];
+    unsigned long calls[PROFILE_N_PHASES];
+    unsigned long nodes_created;
+    unsigned long splits_scored;
+    unsigned long samples_traversed;
+    FILE *stream;
+};
+#endif
+
+
 union fitness_parameters {
-    double linear[10];
+    struct {
+        double weights[10];
+        double *epsilon_scales;
+        unsigned int n_epsilon_scales;
+        Hyperrectangle *boxes;
+    } linear;
 };
 
 
@@ -46,8 +94,13 @@ struct status {
     Population population_swap;
     unsigned int current_iteration;
     Fitness compute_fitness;
+    FitnessBatch compute_fitness_batch;
     FitnessParameters fitness_parameters;
     Select select;
+    double *selection_cumulative;
+    unsigned int *selection_picks;
+    unsigned int n_selection_picks;
+    unsigned int tournament_size;
     Crossover crossover;
     Mutation mutate;
     double base_mutation_probability;
@@ -58,26 +111,60 @@ struct status {
     InitialPopulation initial_population;
     InitialPopulationParameters initial_population_parameters;
     unsigned int max_iteration;
+    double time_limit;
+    unsigned int patience;
+    double patience_delta;
+    double best_fitness;
+    unsigned int n_stalled;
     unsigned int elitism;
     double split_search_aggressiveness;
     AllowFeatures allow_features;
     unsigned int *allowed_features;
     unsigned int n_allowed_features;
+    double racing_delta;
+    unsigned int racing_attempts;
+    double sample_schedule_fraction;
+    double sample_schedule_growth;
+    unsigned int *evaluation_order;
+    unsigned int evaluation_size;
+    double admission_threshold;
+    unsigned int is_rejected;
+    Duplicates duplicates;
+    unsigned int duplicate_attempts;
+    double duplicate_penalty;
+    unsigned int n_duplicates;
+    TreePool pool;
+    char **options;
+    unsigned int n_options;
+    char checkpoint_path[PATH_SIZE];
+    unsigned int checkpoint_interval;
+    long checkpoint_writer;
+    char resume_path[PATH_SIZE];
     void *data;
     Callback callback_start;
     Callback callback_before_iter;
     Callback callback_after_iter;
     Callback callback_end;
+#ifdef PROFILE
+    struct profile profile;
+    Callback callback_profile;
+#endif
     unsigned int seed;
 };
 
 
 double fitness_linear(const Individual individual, Status *status);
 
+void fitness_linear_batch(double *fitness, const Individual *individuals, const unsigned int n, Status *status);
+
 Individual select_uniform(const Population population, Status *status);
 
 Individual select_roulette_wheel(const Population population, Status *status);
 
+Individual select_stochastic_universal(const Population population, Status *status);
+
+Individual select_tournament(const Population population, Status *status);
+
 void crossover_one_point(Individual *offspring, const Individual parent_a, const Individual parent_b, Status *status);
 
 void mutation_none(Individual *individual, Status *status);
@@ -102,6 +189,10 @@ void allow_features_uniform(unsigned int *allowed_features, const unsigned int n
 
 void callback_status_print(Status *status);
 
+#ifdef PROFILE
+void callback_profile_print(Status *status);
+#endif
+
 
 
 DecisionTree ga_train(Status *status, const Dataset training_set);
@@ -1,14 +1,167 @@
+#define _POSIX_C_SOURCE 200112L
+
 #include "silva.h"
 
+#include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../../data/text.h"
 #include "../../decision_tree/mapper/silva.h"
 
 #define BUFFER_SIZE 64
+#define TREE_KEYWORD "classifier-decision-tree"
+
+
+/***********************************************************************
+ * Internal functions.
+ **********************************************************************/
+
+/* Consecutive trees parsed by one thread */
+struct job {
+    pthread_t thread;
+    const char **starts;
+    DecisionTree *trees;
+    Dataset *headers;
+    unsigned int n_trees;
+    unsigned int first;
+    unsigned int last;
+    const char *position;
+};
+
+
+
+/* Trees start with their keyword at the beginning of a line, starts
+ * gets them followed by end of text. Returns number of trees found, or
+ * more than expected if a label looks like a tree. */
+static unsigned int find_trees(const char **starts, const unsigned int n_trees, const char *text, const char *end) {
+    const size_t keyword_length = strlen(TREE_KEYWORD);
+    const char *line = text;
+    unsigned int n = 0;
+
+    while (line < end && isspace((unsigned char) *line)) {
+        ++line;
+    }
+    while (line && line < end) {
+        if ((size_t) (end - line) > keyword_length
+            && memcmp(line, TREE_KEYWORD, keyword_length) == 0
+            && isspace((unsigned char) line[keyword_length])) {
+            if (n == n_trees) {
+                return n + 1;
+            }
+            starts[n++] = line;
+        }
+        line = (const char *) memchr(line, '\n', end - line);
+        if (line) {
+            ++line;
+        }
+    }
+    starts[n] = end;
+
+    return n;
+}
+
 
 
+static void *parse_trees(void *argument) {
+    struct job *job = (struct job *) argument;
+    unsigned int i;
+
+    /* A tree must end where the next one starts, anything may follow
+     * the last one */
+    for (i = job->first; i < job->last; ++i) {
+        const char *position = decision_tree_mapper_silva_parse_model(
+            job->starts[i], job->starts[i + 1], job->trees + i, job->headers + i
+        );
+
+        job->position = position;
+        if (i + 1 == job->n_trees) {
+            break;
+        }
+        while (position < job->starts[i + 1] && isspace((unsigned char) *position)) {
+            ++position;
+        }
+        if (position != job->starts[i + 1]) {
+            fprintf(stderr, "[%s: %d] Cannot parse random forest.\n", __FILE__, __LINE__);
+            abort();
+        }
+    }
+
+    return NULL;
+}
+
+
+
+/* Splits trees among processors when their boundaries can be found,
+ * otherwise parses them one after the other */
+static const char *parse_forest(DecisionTree *trees, Dataset *headers, const unsigned int n_trees, const Text text) {
+    const long n_processors = sysconf(_SC_NPROCESSORS_ONLN);
+    const char **starts = (const char **) malloc((n_trees + 1) * sizeof(const char *));
+    const char *position = text.data;
+    unsigned int n_threads = n_processors > 1 ? n_processors : 1, i;
+    struct job *jobs;
+
+    if (n_threads > n_trees) {
+        n_threads = n_trees;
+    }
+
+    if (n_threads < 2 || find_trees(starts, n_trees, text.data, text.end) != n_trees) {
+        for (i = 0; i < n_trees; ++i) {
+            position = decision_tree_mapper_silva_parse_model(position, text.end, trees + i, headers + i);
+        }
+        free(starts);
+
+        return position;
+    }
+
+    jobs = (struct job *) malloc(n_threads * sizeof(struct job));
+    for (i = 0; i < n_threads; ++i) {
+        jobs[i].starts = starts;
+        jobs[i].trees = trees;
+        jobs[i].headers = headers;
+        jobs[i].n_trees = n_trees;
+        jobs[i].first = (unsigned long) i * n_trees / n_threads;
+        jobs[i].last = (unsigned long) (i + 1) * n_trees / n_threads;
+        pthread_create(&jobs[i].thread, NULL, parse_trees, jobs + i);
+    }
+    for (i = 0; i < n_threads; ++i) {
+        pthread_join(jobs[i].thread, NULL);
+    }
+    position = jobs[n_threads - 1].position;
+    free(jobs);
+    free(starts);
+
+    return position;
+}
+
+
+
+
+
+/***********************************************************************
+ * Public functions.
+ **********************************************************************/
+
 void forest_mapper_silva_load(FILE *fh, Forest *forest, const Dataset dataset) {
+    Dataset header;
+    unsigned int i;
+
+    forest_mapper_silva_load_model(fh, forest, &header);
+    for (i = 0; i < forest->n_trees; ++i) {
+        decision_tree_partition(forest->trees + i, dataset);
+    }
+    dataset_delete(header);
+}
+
+
+
+void forest_mapper_silva_load_model(FILE *fh, Forest *forest, Dataset *header) {
     unsigned int n_trees, i, n;
     char buffer[BUFFER_SIZE];
+    DecisionTree *trees;
+    Dataset *headers;
+    Text text;
 
     if (!fh) {
         fprintf(stderr, "[%s: %d] Cannot read file.\n", __FILE__, __LINE__);
@@ -21,13 +174,32 @@ void forest_mapper_silva_load(FILE *fh, Forest *forest, const Dataset dataset) {
         abort();
     }
 
-
     forest_create(forest);
+    if (n_trees == 0) {
+        dataset_create(header, 0, 0);
+        return;
+    }
+
+    trees = (DecisionTree *) malloc(n_trees * sizeof(DecisionTree));
+    headers = (Dataset *) malloc(n_trees * sizeof(Dataset));
+    text_open(&text, fh);
+    text_close(&text, parse_forest(trees, headers, n_trees, text));
+
+    /* Trees share the header of the first one */
+    *header = headers[0];
     for (i = 0; i < n_trees; ++i) {
-        DecisionTree tree;
-        decision_tree_mapper_silva_load(fh, &tree, dataset);
-        forest_add_tree(forest, tree);
+        if (i > 0) {
+            if (headers[i].space_size != header->space_size || headers[i].n_labels != header->n_labels) {
+                fprintf(stderr, "[%s: %d] Trees of the forest disagree on features or labels.\n", __FILE__, __LINE__);
+                abort();
+            }
+            trees[i].dataset = *header;
+            dataset_delete(headers[i]);
+        }
+        forest_add_tree(forest, trees[i]);
     }
+    free(trees);
+    free(headers);
 }
 
 
@@ -9,6 +9,10 @@
 
 void forest_mapper_silva_load(FILE *fh, Forest *forest, const Dataset dataset);
 
+/* Loads trees without a training set, they share the header of the first
+ * one */
+void forest_mapper_silva_load_model(FILE *fh, Forest *forest, Dataset *header);
+
 void forest_mapper_silva_save(FILE *fh, const Forest forest);
 
 #endif
@@ -3,6 +3,7 @@
 #include <string.h>
 
 #include "data/dataset.h"
+#include "data_structures/counters.h"
 #include "decision_tree/decision_tree.h"
 #include "decision_tree/mapper/silva.h"
 #include "forest/forest.h"
@@ -16,7 +17,7 @@
  **********************************************************************/
 
 static void display_usage(char *name) {
-    fprintf(stderr, "Usage: %s assemble|disassemble <dataset path> <forest path> arguments\n", name);
+    fprintf(stderr, "Usage: %s assemble|disassemble <dataset path> <forest path> arguments [--counters]\n", name);
     fprintf(stderr, "Arguments:\n");
     fprintf(stderr, "  for \"assemble\":  list of paths of tree to assemble into forest\n");
     fprintf(stderr, "  for \"dissemble\": path of directory to store trees\n");
@@ -83,6 +84,7 @@ static void disassemble_forest(int argc, char **argv, const Dataset dataset) {
  * Main entry point
  **********************************************************************/
 int main(int argc, char **argv) {
+    const unsigned int is_counting = counters_requested(&argc, argv);
     FILE *stream;
     Dataset dataset;
 
@@ -109,6 +111,10 @@ int main(int argc, char **argv) {
         exit(EXIT_FAILURE);
     }
 
+    if (is_counting) {
+        counters_print(stderr);
+    }
+
     /* Frees memory */
     dataset_delete(dataset);
 
@@ -2,12 +2,14 @@
 #include <stdlib.h>
 
 #include "data/dataset.h"
+#include "data_structures/counters.h"
 #include "decision_tree/decision_tree.h"
 #include "decision_tree/mapper/silva.h"
 #include "decision_tree/training/genetic_algorithm.h"
 
 
 int main(int argc, char *argv[]) {
+    const unsigned int is_counting = counters_requested(&argc, argv);
     Dataset training_set;
     DecisionTree tree;
     Status status;
@@ -15,7 +17,7 @@ int main(int argc, char *argv[]) {
 
     /* Checks input */
     if (argc < 3) {
-        fprintf(stderr, "Usage: %s <training set path> <output model path> [options]\n", argv[0]);
+        fprintf(stderr, "Usage: %s <training set path> <output model path> [options] [--counters]\n", argv[0]);
         ga_options_print(stderr);
         exit(EXIT_FAILURE);
     }
@@ -36,6 +38,9 @@ int main(int argc, char *argv[]) {
     fh = fopen(argv[2], "w");
     decision_tree_mapper_silva_save(fh, tree);
     fclose(fh);
+    if (is_counting) {
+        counters_print(stderr);
+    }
 
     /* Frees memory */
     dataset_delete(training_set);
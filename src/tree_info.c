@@ -1,11 +1,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
+#include "data_structures/counters.h"
 #include "data_structures/stack.h"
 #include "data/dataset.h"
 #include "decision_tree/decision_tree.h"
 #include "decision_tree/mapper/silva.h"
+#include "decision_tree/performance/performance.h"
 #include "data_structures/distribution.h"
 
 
@@ -45,6 +48,65 @@ static void compute_feature_frequencies(unsigned int *frequencies, const Decisio
 
 
 
+static void display_stability_radii(FILE *stream, const DecisionTree tree, const double *epsilons, const unsigned int n_epsilons) {
+    const unsigned int size = tree.dataset.size;
+    double *radii = (double *) malloc(size * sizeof(double));
+    unsigned int i, n_bounded = 0,
+                 *counts = (unsigned int *) malloc(n_epsilons * sizeof(unsigned int));
+    Distribution bounded;
+
+    /* Samples no perturbation can make unstable are counted apart */
+    decision_tree_stability_radii(radii, tree, tree.dataset, NULL, size);
+    for (i = 0; i < size; ++i) {
+        n_bounded += radii[i] != HUGE_VAL;
+    }
+
+    distribution_create(&bounded, n_bounded);
+    n_bounded = 0;
+    for (i = 0; i < size; ++i) {
+        if (radii[i] != HUGE_VAL) {
+            bounded.values[n_bounded++] = radii[i];
+        }
+    }
+
+    fprintf(stream, "Stability radius (%u samples unbounded):\n", size - n_bounded);
+    if (n_bounded > 0) {
+        print_distribution(stream, &bounded);
+    }
+
+    /* Stable samples at every epsilon come from the same radii */
+    if (n_epsilons > 0) {
+        decision_tree_stable_counts(counts, radii, size, epsilons, n_epsilons);
+        fprintf(stream, "Stable samples by radius:\n");
+        for (i = 0; i < n_epsilons; ++i) {
+            fprintf(stream, "  epsilon: %g    stable: %u\n", epsilons[i], counts[i]);
+        }
+    }
+
+    distribution_delete(bounded);
+    free(radii);
+    free(counts);
+}
+
+
+
+static void display_performances(FILE *stream, const DecisionTree tree, const double *epsilons, const unsigned int n_epsilons) {
+    Performance *performances = (Performance *) malloc(n_epsilons * sizeof(Performance));
+    unsigned int i;
+
+    decision_tree_performance_multi(performances, tree, tree.dataset, epsilons, n_epsilons);
+
+    fprintf(stream, "Performance:\n");
+    for (i = 0; i < n_epsilons; ++i) {
+        fprintf(stream, "  epsilon: %g    ", epsilons[i]);
+        decision_tree_performance_print(stream, performances[i]);
+    }
+
+    free(performances);
+}
+
+
+
 static void display_information(FILE *stream, const DecisionTree tree) {
     const unsigned int n_nodes = decision_tree_n_nodes(tree),
                        n_leaves = decision_tree_n_leaves(tree);
@@ -95,16 +157,40 @@ static void display_information(FILE *stream, const DecisionTree tree) {
  **********************************************************************/
 
 int main(int argc, char *argv[]) {
+    const unsigned int is_counting = counters_requested(&argc, argv);
+    unsigned int n_epsilons = 0, is_computing_radii = 0;
+    double *epsilons;
+    char *end;
     DecisionTree tree;
     Dataset dataset;
     FILE *stream;
+    int a;
 
     /* Checks input */
     if (argc < 3) {
-        fprintf(stderr, "Usage: %s <model path> <dataset path>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <model path> <dataset path> [epsilon...] [--radii] [--counters]\n", argv[0]);
+        fprintf(stderr, "  --radii  Also reports exact stability radii of samples\n");
         exit(EXIT_FAILURE);
     }
 
+    epsilons = (double *) malloc((argc - 3) * sizeof(double));
+    for (a = 3; a < argc; ++a) {
+        if (strcmp(argv[a], "--radii") == 0) {
+            is_computing_radii = 1;
+            continue;
+        }
+        epsilons[n_epsilons] = strtod(argv[a], &end);
+        if (end == argv[a] || *end != '\0' || !(epsilons[n_epsilons] >= 0.0)) {
+            fprintf(stderr, "Epsilon \"%s\" is not a non-negative number.\n", argv[a]);
+            exit(EXIT_FAILURE);
+        }
+        if (n_epsilons > 0 && epsilons[n_epsilons] < epsilons[n_epsilons - 1]) {
+            fprintf(stderr, "Epsilons must be sorted in ascending order.\n");
+            exit(EXIT_FAILURE);
+        }
+        ++n_epsilons;
+    }
+
     /* Reads dataset */
     stream = fopen(argv[2], "r");
     dataset_load(stream, &dataset);
@@ -117,8 +203,18 @@ int main(int argc, char *argv[]) {
 
     /* Displays information */
     display_information(stdout, tree);
+    if (is_computing_radii) {
+        display_stability_radii(stdout, tree, epsilons, n_epsilons);
+    }
+    if (n_epsilons > 0) {
+        display_performances(stdout, tree, epsilons, n_epsilons);
+    }
+    if (is_counting) {
+        counters_print(stderr);
+    }
 
     /* Frees memory */
+    free(epsilons);
     dataset_delete(dataset);
     decision_tree_delete(tree);
 
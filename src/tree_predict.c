@@ -0,0 +1,254 @@
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "data/dataset.h"
+#include "data_structures/counters.h"
+#include "decision_tree/decision_tree.h"
+#include "decision_tree/flat/flat_tree.h"
+#include "decision_tree/mapper/silva.h"
+
+#define DEFAULT_CHUNK_SIZE 65536
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+
+/***********************************************************************
+ * Support functions.
+ **********************************************************************/
+
+/* Slice of a chunk classified by one thread. Every worker owns a copy
+ * of the flat tree with its own scratch space. */
+struct worker {
+    pthread_t thread;
+    FlatTree tree;
+    const double *points;
+    unsigned int space_size;
+    unsigned int n;
+    Bitmask *labels;
+    unsigned char *stable;
+    const double *epsilons;
+    double *columns;
+};
+
+
+
+static void display_usage(char *name) {
+    fprintf(stderr, "Usage: %s <model path> <input path> [options]\n", name);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --output path  Writes labels to path instead of standard output\n");
+    fprintf(stderr, "  --epsilon e    Also tells whether every sample is stable under perturbations up to e\n");
+    fprintf(stderr, "  --threads n    Number of classifying threads, defaults to number of processors\n");
+    fprintf(stderr, "  --chunk n      Number of samples read at a time\n");
+    fprintf(stderr, "  --counters     Prints hot-path counters (requires make COUNTERS=1)\n");
+}
+
+
+
+static void *classify_slice(void *argument) {
+    struct worker *worker = (struct worker *) argument;
+    unsigned int i, s;
+
+    flat_tree_classify_batch(worker->labels, worker->tree, worker->points, worker->space_size, NULL, worker->n);
+
+    if (worker->epsilons) {
+        for (i = 0; i < worker->n; i += FLAT_TREE_BLOCK_SIZE) {
+            const unsigned int n = i + FLAT_TREE_BLOCK_SIZE < worker->n ? FLAT_TREE_BLOCK_SIZE : worker->n - i;
+            const Bitmask stable = flat_tree_stable_batch(
+                worker->tree, worker->points + i * worker->space_size, worker->space_size, NULL, n,
+                worker->labels + i, worker->epsilons, NULL, worker->columns
+            );
+
+            for (s = 0; s < n; ++s) {
+                worker->stable[i + s] = (stable >> s) & 1;
+            }
+        }
+    }
+
+    counters_merge();
+
+    return NULL;
+}
+
+
+
+static void write_labels(FILE *stream, const Bitmask labels, const Dataset header) {
+    unsigned int i, is_first = 1;
+
+    for (i = 0; i < header.n_labels; ++i) {
+        if (bitmask_is_set(labels, i)) {
+            if (!is_first) {
+                fputc('|', stream);
+            }
+            fputs(header.labels[i], stream);
+            is_first = 0;
+        }
+    }
+}
+
+
+
+
+
+/***********************************************************************
+ * Main entry point.
+ **********************************************************************/
+
+int main(int argc, char *argv[]) {
+    const unsigned int is_counting = counters_requested(&argc, argv);
+    unsigned int chunk_size, n_threads, n, t, i;
+    char *output_path = NULL, *buffer, *end;
+    double epsilon = -1.0, *points, *epsilons = NULL;
+    Bitmask *labels;
+    unsigned char *stable;
+    struct worker *workers;
+    DecisionTree tree;
+    FlatTree flat_tree;
+    Dataset header;
+    DatasetStream input;
+    FILE *stream, *output;
+    int a, chunk_option = DEFAULT_CHUNK_SIZE,
+        threads_option = sysconf(_SC_NPROCESSORS_ONLN) > 0 ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+
+    /* Checks input */
+    if (argc < 3) {
+        display_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    for (a = 3; a < argc; ++a) {
+        if (a + 1 < argc && strcmp(argv[a], "--output") == 0) {
+            output_path = argv[++a];
+        }
+        else if (a + 1 < argc && strcmp(argv[a], "--epsilon") == 0) {
+            epsilon = strtod(argv[++a], &end);
+            if (end == argv[a] || *end != '\0' || !(epsilon >= 0.0 && epsilon <= DBL_MAX)) {
+                fprintf(stderr, "Epsilon must be a non-negative finite number.\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (a + 1 < argc && strcmp(argv[a], "--threads") == 0) {
+            threads_option = atoi(argv[++a]);
+        }
+        else if (a + 1 < argc && strcmp(argv[a], "--chunk") == 0) {
+            chunk_option = atoi(argv[++a]);
+        }
+        else {
+            display_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (threads_option <= 0 || chunk_option <= 0) {
+        fprintf(stderr, "Threads and chunk size must be positive.\n");
+        exit(EXIT_FAILURE);
+    }
+    n_threads = threads_option;
+    chunk_size = chunk_option;
+
+    /* Reads decision tree, labels and features come from its header */
+    stream = fopen(argv[1], "r");
+    if (stream == NULL) {
+        fprintf(stderr, "Cannot open \"%s\".\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    decision_tree_mapper_silva_load_model(stream, &tree, &header);
+    fclose(stream);
+    flat_tree_create(&flat_tree, tree);
+
+    /* Opens input and output, memory is bounded by chunk size */
+    stream = fopen(argv[2], "r");
+    dataset_stream_open(&input, stream);
+    if (input.space_size != header.space_size) {
+        fprintf(stderr, "Input has %u features, model expects %u.\n", input.space_size, header.space_size);
+        exit(EXIT_FAILURE);
+    }
+    output = output_path ? fopen(output_path, "w") : stdout;
+    if (output == NULL) {
+        fprintf(stderr, "Cannot open \"%s\" for writing.\n", output_path);
+        exit(EXIT_FAILURE);
+    }
+    buffer = (char *) malloc(OUTPUT_BUFFER_SIZE);
+    setvbuf(output, buffer, _IOFBF, OUTPUT_BUFFER_SIZE);
+
+    points = (double *) malloc(chunk_size * input.space_size * sizeof(double));
+    labels = (Bitmask *) malloc(chunk_size * sizeof(Bitmask));
+    stable = (unsigned char *) malloc(chunk_size * sizeof(unsigned char));
+    if (epsilon >= 0.0) {
+        epsilons = (double *) malloc(input.space_size * sizeof(double));
+        for (i = 0; i < input.space_size; ++i) {
+            epsilons[i] = epsilon;
+        }
+    }
+
+    workers = (struct worker *) malloc(n_threads * sizeof(struct worker));
+    for (t = 0; t < n_threads; ++t) {
+        workers[t].tree = flat_tree;
+        workers[t].tree.reached = (Bitmask *) malloc(flat_tree.n_nodes * sizeof(Bitmask));
+        workers[t].space_size = input.space_size;
+        workers[t].epsilons = epsilons;
+        workers[t].columns = (double *) malloc(2 * input.space_size * FLAT_TREE_BLOCK_SIZE * sizeof(double));
+    }
+
+    /* Classifies a chunk at a time, splitting it among threads at
+     * multiples of the block size */
+    while ((n = dataset_stream_read(&input, points, chunk_size)) > 0) {
+        const unsigned int n_blocks = (n + FLAT_TREE_BLOCK_SIZE - 1) / FLAT_TREE_BLOCK_SIZE,
+                           blocks_per_thread = (n_blocks + n_threads - 1) / n_threads;
+
+        for (t = 0; t < n_threads; ++t) {
+            const unsigned int first = t * blocks_per_thread * FLAT_TREE_BLOCK_SIZE,
+                               last = first + blocks_per_thread * FLAT_TREE_BLOCK_SIZE;
+
+            workers[t].points = points + first * input.space_size;
+            workers[t].n = first >= n ? 0 : (last < n ? last : n) - first;
+            workers[t].labels = labels + first;
+            workers[t].stable = stable + first;
+            if (workers[t].n > 0) {
+                pthread_create(&workers[t].thread, NULL, classify_slice, workers + t);
+            }
+        }
+        for (t = 0; t < n_threads; ++t) {
+            if (workers[t].n > 0) {
+                pthread_join(workers[t].thread, NULL);
+            }
+        }
+
+        for (i = 0; i < n; ++i) {
+            write_labels(output, labels[i], header);
+            if (epsilons) {
+                fputs(stable[i] ? ",stable" : ",unstable", output);
+            }
+            fputc('\n', output);
+        }
+    }
+
+    if (fclose(output) != 0) {
+        fprintf(stderr, "Cannot write labels.\n");
+        exit(EXIT_FAILURE);
+    }
+    if (is_counting) {
+        counters_print(stderr);
+    }
+
+    /* Frees memory */
+    for (t = 0; t < n_threads; ++t) {
+        free(workers[t].tree.reached);
+        free(workers[t].columns);
+    }
+    free(workers);
+    free(points);
+    free(labels);
+    free(stable);
+    free(epsilons);
+    free(buffer);
+    dataset_stream_close(&input);
+    fclose(stream);
+    flat_tree_delete(flat_tree);
+    decision_tree_delete(tree);
+    dataset_delete(header);
+
+    return EXIT_SUCCESS;
+}
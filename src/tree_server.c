@@ -0,0 +1,680 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "data/dataset.h"
+#include "data_structures/counters.h"
+#include "data_structures/distribution.h"
+#include "data_structures/stopwatch.h"
+#include "decision_tree/decision_tree.h"
+#include "decision_tree/flat/flat_tree.h"
+#include "decision_tree/mapper/silva.h"
+#include "forest/forest.h"
+#include "forest/mapper/silva.h"
+
+#define DEFAULT_N_THREADS 4
+#define QUEUE_SIZE 64
+#define LATENCY_WINDOW 65536
+#define MAX_REQUEST_SAMPLES (1U << 20)
+#define MAX_REQUEST_VALUES (1UL << 25)
+#define FLAG_STABILITY 0x1
+
+/* Framing, native byte order since clients are local.
+ *
+ * Request:  uint32 model, uint32 samples, uint32 features, uint32 flags,
+ *           double epsilon, then samples * features doubles.
+ * Response: uint32 status, uint32 samples, then one uint64 label bitmask
+ *           per sample and, if FLAG_STABILITY was set, one byte per
+ *           sample, 1 if every point within epsilon gets same labels.
+ *           Epsilon must be a non-negative number if stability is asked.
+ *
+ * A request holds at most MAX_REQUEST_SAMPLES samples and at most
+ * MAX_REQUEST_VALUES doubles. A connection carries any number of
+ * requests. */
+enum response_status {
+    STATUS_OK = 0,
+    STATUS_UNKNOWN_MODEL = 1,
+    STATUS_WRONG_FEATURES = 2,
+    STATUS_TOO_MANY_SAMPLES = 3,
+    STATUS_WRONG_EPSILON = 4
+};
+
+
+/***********************************************************************
+ * Support functions.
+ **********************************************************************/
+
+/* A tree or a forest, as flat trees voting for labels */
+struct model {
+    FlatTree *trees;
+    unsigned int n_trees;
+};
+
+
+struct server;
+
+
+/* Worker serving one connection at a time, with buffers reused across
+ * requests */
+struct worker {
+    pthread_t thread;
+    struct server *server;
+    int client;
+    double *points;
+    Bitmask *labels;
+    Bitmask *tree_labels;
+    unsigned int *votes;
+    unsigned char *stable;
+    unsigned int capacity;
+    Bitmask *reached;
+    double *columns;
+    double *epsilons;
+};
+
+
+/* Connections accepted but not served yet wait in a ring buffer;
+ * latencies of last requests are kept in another one */
+struct server {
+    int listener;
+    struct model *models;
+    unsigned int n_models;
+    unsigned int space_size;
+    unsigned int n_labels;
+    unsigned int max_nodes;
+    struct worker *workers;
+    unsigned int n_workers;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    int queue[QUEUE_SIZE];
+    unsigned int queue_first;
+    unsigned int queue_size;
+    double *latencies;
+    unsigned long n_requests;
+    unsigned int report_interval;
+    unsigned int is_stopping;
+};
+
+
+
+/* Parses a whole non-negative integer, telling whether it succeeded */
+static unsigned int parse_count(const char *text, unsigned int *count) {
+    char *end;
+    const long value = strtol(text, &end, 10);
+
+    if (end == text || *end != '\0' || value < 0 || (unsigned long) value > UINT_MAX) {
+        return 0;
+    }
+    *count = value;
+
+    return 1;
+}
+
+
+
+static void display_usage(char *name) {
+    fprintf(stderr, "Usage: %s <socket path> [options]\n", name);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --tree path    Serves a silva decision tree, models are numbered from 0 in order\n");
+    fprintf(stderr, "  --forest path  Serves a silva forest, voting among its trees\n");
+    fprintf(stderr, "  --threads n    Number of connections served at the same time\n");
+    fprintf(stderr, "  --report n     Prints latency percentiles every n requests, 0 only at exit\n");
+    fprintf(stderr, "  --counters     Prints hot-path counters at exit (requires make COUNTERS=1)\n");
+}
+
+
+
+static void model_create(struct model *model, const DecisionTree *trees, const unsigned int n_trees) {
+    unsigned int i;
+
+    model->n_trees = n_trees;
+    model->trees = (FlatTree *) malloc(n_trees * sizeof(FlatTree));
+    for (i = 0; i < n_trees; ++i) {
+        flat_tree_create(model->trees + i, trees[i]);
+    }
+}
+
+
+
+static void model_delete(struct model model) {
+    unsigned int i;
+
+    for (i = 0; i < model.n_trees; ++i) {
+        flat_tree_delete(model.trees[i]);
+    }
+    free(model.trees);
+}
+
+
+
+static int read_full(const int fd, void *data, const size_t size) {
+    char *bytes = (char *) data;
+    size_t done = 0;
+
+    while (done < size) {
+        const ssize_t n = read(fd, bytes + done, size - done);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 0;
+        }
+        done += n;
+    }
+
+    return 1;
+}
+
+
+
+static int write_full(const int fd, const void *data, const size_t size) {
+    const char *bytes = (const char *) data;
+    size_t done = 0;
+
+    while (done < size) {
+        const ssize_t n = write(fd, bytes + done, size - done);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 0;
+        }
+        done += n;
+    }
+
+    return 1;
+}
+
+
+
+static void worker_reserve(struct worker *worker, const unsigned int n) {
+    const struct server *server = worker->server;
+
+    if (n <= worker->capacity) {
+        return;
+    }
+
+    worker->capacity = n;
+    worker->points = (double *) realloc(worker->points, (size_t) n * server->space_size * sizeof(double));
+    worker->labels = (Bitmask *) realloc(worker->labels, (size_t) n * sizeof(Bitmask));
+    worker->tree_labels = (Bitmask *) realloc(worker->tree_labels, (size_t) n * sizeof(Bitmask));
+    worker->votes = (unsigned int *) realloc(worker->votes, (size_t) n * server->n_labels * sizeof(unsigned int));
+    worker->stable = (unsigned char *) realloc(worker->stable, (size_t) n * sizeof(unsigned char));
+}
+
+
+
+/* Labels with most votes win; a forest is reported stable only if each
+ * of its trees is, which is sound but may miss some stable samples */
+static void classify(struct worker *worker, const struct model model, const unsigned int n, const unsigned int is_checking_stability) {
+    const unsigned int space_size = worker->server->space_size,
+                       n_labels = worker->server->n_labels;
+    unsigned int t, i, l;
+
+    if (model.n_trees == 1) {
+        flat_tree_classify_batch(worker->labels, model.trees[0], worker->points, space_size, NULL, n);
+    }
+    else {
+        memset(worker->votes, 0, (size_t) n * n_labels * sizeof(unsigned int));
+        for (t = 0; t < model.n_trees; ++t) {
+            flat_tree_classify_batch(worker->tree_labels, model.trees[t], worker->points, space_size, NULL, n);
+            for (i = 0; i < n; ++i) {
+                for (l = 0; l < n_labels; ++l) {
+                    worker->votes[i * n_labels + l] += bitmask_is_set(worker->tree_labels[i], l) ? 1 : 0;
+                }
+            }
+        }
+        for (i = 0; i < n; ++i) {
+            unsigned int max_votes = 0;
+
+            worker->labels[i] = BITMASK_NOTHING;
+            for (l = 0; l < n_labels; ++l) {
+                max_votes = worker->votes[i * n_labels + l] > max_votes ? worker->votes[i * n_labels + l] : max_votes;
+            }
+            for (l = 0; l < n_labels; ++l) {
+                if (worker->votes[i * n_labels + l] == max_votes) {
+                    bitmask_set(worker->labels[i], l);
+                }
+            }
+        }
+    }
+
+    if (!is_checking_stability) {
+        return;
+    }
+
+    memset(worker->stable, 1, n);
+    for (t = 0; t < model.n_trees; ++t) {
+        FlatTree tree = model.trees[t];
+        const Bitmask *labels = worker->labels;
+
+        tree.reached = worker->reached;
+        if (model.n_trees > 1) {
+            flat_tree_classify_batch(worker->tree_labels, tree, worker->points, space_size, NULL, n);
+            labels = worker->tree_labels;
+        }
+        for (i = 0; i < n; i += FLAT_TREE_BLOCK_SIZE) {
+            const unsigned int m = i + FLAT_TREE_BLOCK_SIZE < n ? FLAT_TREE_BLOCK_SIZE : n - i;
+            const Bitmask stable = flat_tree_stable_batch(
+                tree, worker->points + i * space_size, space_size, NULL, m,
+                labels + i, worker->epsilons, NULL, worker->columns
+            );
+
+            for (l = 0; l < m; ++l) {
+                worker->stable[i + l] &= (stable >> l) & 1;
+            }
+        }
+    }
+}
+
+
+
+static void report(FILE *stream, struct server *server) {
+    const unsigned int n = server->n_requests < LATENCY_WINDOW ? server->n_requests : LATENCY_WINDOW;
+    Distribution latencies;
+
+    if (n == 0) {
+        fprintf(stream, "Requests: 0\n");
+        return;
+    }
+
+    distribution_create(&latencies, n);
+    memcpy(latencies.values, server->latencies, n * sizeof(double));
+    fprintf(stream, "Requests: %lu    latency (ms, last %u): p50 %.3f    p90 %.3f    p99 %.3f    max %.3f\n",
+            server->n_requests, n,
+            distribution_nth_percentile(&latencies, 50), distribution_nth_percentile(&latencies, 90),
+            distribution_nth_percentile(&latencies, 99), distribution_max(&latencies));
+    fflush(stream);
+    distribution_delete(latencies);
+}
+
+
+
+static void serve(struct worker *worker, const int client) {
+    struct server *server = worker->server;
+    Stopwatch stopwatch;
+
+    stopwatch_create(&stopwatch);
+    while (1) {
+        uint32_t header[4], response[2];
+        double epsilon;
+        unsigned int i;
+
+        if (!read_full(client, header, sizeof(header)) || !read_full(client, &epsilon, sizeof(epsilon))) {
+            break;
+        }
+        stopwatch_reset(stopwatch);
+
+        response[0] = STATUS_OK;
+        response[1] = header[1];
+        if (header[0] >= server->n_models) {
+            response[0] = STATUS_UNKNOWN_MODEL;
+        }
+        else if (header[2] != server->space_size) {
+            response[0] = STATUS_WRONG_FEATURES;
+        }
+        else if (header[1] > MAX_REQUEST_SAMPLES || (size_t) header[1] * server->space_size > MAX_REQUEST_VALUES) {
+            response[0] = STATUS_TOO_MANY_SAMPLES;
+        }
+        else if ((header[3] & FLAG_STABILITY) && !(epsilon >= 0.0)) {
+            response[0] = STATUS_WRONG_EPSILON;
+        }
+        if (response[0] != STATUS_OK) {
+            response[1] = 0;
+            write_full(client, response, sizeof(response));
+            break;
+        }
+
+        worker_reserve(worker, header[1]);
+        if (!read_full(client, worker->points, (size_t) header[1] * server->space_size * sizeof(double))) {
+            break;
+        }
+        for (i = 0; i < server->space_size; ++i) {
+            worker->epsilons[i] = epsilon;
+        }
+
+        classify(worker, server->models[header[0]], header[1], header[3] & FLAG_STABILITY);
+
+        if (!write_full(client, response, sizeof(response))
+            || !write_full(client, worker->labels, (size_t) header[1] * sizeof(Bitmask))
+            || ((header[3] & FLAG_STABILITY) && !write_full(client, worker->stable, header[1]))) {
+            break;
+        }
+
+        stopwatch_stop(stopwatch);
+        pthread_mutex_lock(&server->lock);
+        server->latencies[server->n_requests % LATENCY_WINDOW] = stopwatch_get_elapsed_time_milliseconds(stopwatch);
+        ++server->n_requests;
+        if (server->report_interval > 0 && server->n_requests % server->report_interval == 0) {
+            report(stderr, server);
+        }
+        pthread_mutex_unlock(&server->lock);
+    }
+    stopwatch_delete(&stopwatch);
+}
+
+
+
+static void *work(void *argument) {
+    struct worker *worker = (struct worker *) argument;
+    struct server *server = worker->server;
+
+    while (1) {
+        int client;
+
+        pthread_mutex_lock(&server->lock);
+        while (server->queue_size == 0 && !server->is_stopping) {
+            pthread_cond_wait(&server->not_empty, &server->lock);
+        }
+        if (server->is_stopping) {
+            pthread_mutex_unlock(&server->lock);
+            break;
+        }
+        client = server->queue[server->queue_first];
+        server->queue_first = (server->queue_first + 1) % QUEUE_SIZE;
+        --server->queue_size;
+        worker->client = client;
+        pthread_cond_signal(&server->not_full);
+        pthread_mutex_unlock(&server->lock);
+
+        serve(worker, client);
+
+        pthread_mutex_lock(&server->lock);
+        worker->client = -1;
+        pthread_mutex_unlock(&server->lock);
+        close(client);
+    }
+
+    counters_merge();
+
+    return NULL;
+}
+
+
+
+/* Waits for a termination signal, then wakes the acceptor up, whether
+ * blocked on the listener or on a full queue */
+static void *wait_signal(void *argument) {
+    struct server *server = (struct server *) argument;
+    sigset_t signals;
+    int received;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigwait(&signals, &received);
+
+    pthread_mutex_lock(&server->lock);
+    server->is_stopping = 1;
+    pthread_cond_broadcast(&server->not_full);
+    pthread_cond_broadcast(&server->not_empty);
+    pthread_mutex_unlock(&server->lock);
+    shutdown(server->listener, SHUT_RDWR);
+
+    return NULL;
+}
+
+
+
+
+
+/***********************************************************************
+ * Main entry point.
+ **********************************************************************/
+
+int main(int argc, char *argv[]) {
+    const unsigned int is_counting = counters_requested(&argc, argv);
+    struct server server;
+    struct sockaddr_un address;
+    pthread_t signal_thread;
+    sigset_t signals;
+    Dataset *headers = NULL;
+    DecisionTree *trees = NULL;
+    Forest *forests = NULL;
+    unsigned int *is_forest = NULL, n_threads = DEFAULT_N_THREADS, i, t;
+    struct stat socket_status;
+    FILE *stream;
+    int a;
+
+    /* Checks input */
+    if (argc < 4) {
+        display_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+    if (strlen(argv[1]) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Socket path is too long.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Reads models, which must agree on features and labels */
+    server.n_models = 0;
+    server.report_interval = 0;
+    for (a = 2; a < argc; ++a) {
+        if (a + 1 < argc && (strcmp(argv[a], "--tree") == 0 || strcmp(argv[a], "--forest") == 0)) {
+            trees = (DecisionTree *) realloc(trees, (server.n_models + 1) * sizeof(DecisionTree));
+            forests = (Forest *) realloc(forests, (server.n_models + 1) * sizeof(Forest));
+            headers = (Dataset *) realloc(headers, (server.n_models + 1) * sizeof(Dataset));
+            is_forest = (unsigned int *) realloc(is_forest, (server.n_models + 1) * sizeof(unsigned int));
+            is_forest[server.n_models] = strcmp(argv[a], "--forest") == 0;
+            stream = fopen(argv[++a], "r");
+            if (stream == NULL) {
+                fprintf(stderr, "Cannot open \"%s\".\n", argv[a]);
+                exit(EXIT_FAILURE);
+            }
+            if (is_forest[server.n_models]) {
+                forest_mapper_silva_load_model(stream, forests + server.n_models, headers + server.n_models);
+            }
+            else {
+                decision_tree_mapper_silva_load_model(stream, trees + server.n_models, headers + server.n_models);
+            }
+            fclose(stream);
+            if (headers[server.n_models].space_size != headers[0].space_size
+                || headers[server.n_models].n_labels != headers[0].n_labels) {
+                fprintf(stderr, "Model \"%s\" disagrees with the first one on features or labels.\n", argv[a]);
+                exit(EXIT_FAILURE);
+            }
+            ++server.n_models;
+        }
+        else if (a + 1 < argc && strcmp(argv[a], "--threads") == 0) {
+            if (!parse_count(argv[++a], &n_threads) || n_threads == 0) {
+                display_usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (a + 1 < argc && strcmp(argv[a], "--report") == 0) {
+            if (!parse_count(argv[++a], &server.report_interval)) {
+                display_usage(argv[0]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else {
+            display_usage(argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (server.n_models == 0) {
+        display_usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    server.space_size = headers[0].space_size;
+    server.n_labels = headers[0].n_labels;
+    server.max_nodes = 0;
+    server.models = (struct model *) malloc(server.n_models * sizeof(struct model));
+    for (i = 0; i < server.n_models; ++i) {
+        if (is_forest[i]) {
+            model_create(server.models + i, forests[i].trees, forests[i].n_trees);
+        }
+        else {
+            model_create(server.models + i, trees + i, 1);
+        }
+        for (t = 0; t < server.models[i].n_trees; ++t) {
+            if (server.models[i].trees[t].n_nodes > server.max_nodes) {
+                server.max_nodes = server.models[i].trees[t].n_nodes;
+            }
+        }
+    }
+
+    /* Listens on socket */
+    server.listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, argv[1]);
+    if (lstat(argv[1], &socket_status) == 0) {
+        if (!S_ISSOCK(socket_status.st_mode)) {
+            fprintf(stderr, "\"%s\" exists and is not a socket.\n", argv[1]);
+            exit(EXIT_FAILURE);
+        }
+        unlink(argv[1]);
+    }
+    if (server.listener < 0
+        || bind(server.listener, (struct sockaddr *) &address, sizeof(address)) != 0
+        || listen(server.listener, QUEUE_SIZE) != 0) {
+        fprintf(stderr, "Cannot listen on \"%s\": %s.\n", argv[1], strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    /* Signals are handled by a dedicated thread, other threads inherit
+     * the mask blocking them; writes to closed sockets fail instead of
+     * killing the process */
+    signal(SIGPIPE, SIG_IGN);
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    pthread_mutex_init(&server.lock, NULL);
+    pthread_cond_init(&server.not_empty, NULL);
+    pthread_cond_init(&server.not_full, NULL);
+    server.queue_first = 0;
+    server.queue_size = 0;
+    server.latencies = (double *) malloc(LATENCY_WINDOW * sizeof(double));
+    server.n_requests = 0;
+    server.is_stopping = 0;
+
+    server.n_workers = n_threads;
+    server.workers = (struct worker *) malloc(n_threads * sizeof(struct worker));
+    for (t = 0; t < n_threads; ++t) {
+        struct worker *worker = server.workers + t;
+
+        worker->server = &server;
+        worker->client = -1;
+        worker->points = NULL;
+        worker->labels = NULL;
+        worker->tree_labels = NULL;
+        worker->votes = NULL;
+        worker->stable = NULL;
+        worker->capacity = 0;
+        worker->reached = (Bitmask *) malloc(server.max_nodes * sizeof(Bitmask));
+        worker->columns = (double *) malloc(2 * server.space_size * FLAT_TREE_BLOCK_SIZE * sizeof(double));
+        worker->epsilons = (double *) malloc(server.space_size * sizeof(double));
+        pthread_create(&worker->thread, NULL, work, worker);
+    }
+    pthread_create(&signal_thread, NULL, wait_signal, &server);
+
+    fprintf(stderr, "Serving %u models on %s with %u threads.\n", server.n_models, argv[1], n_threads);
+
+    /* Accepts connections until a termination signal */
+    while (1) {
+        const int client = accept(server.listener, NULL, NULL);
+
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            break;
+        }
+
+        pthread_mutex_lock(&server.lock);
+        while (server.queue_size == QUEUE_SIZE && !server.is_stopping) {
+            pthread_cond_wait(&server.not_full, &server.lock);
+        }
+        if (server.is_stopping) {
+            pthread_mutex_unlock(&server.lock);
+            close(client);
+            break;
+        }
+        server.queue[(server.queue_first + server.queue_size) % QUEUE_SIZE] = client;
+        ++server.queue_size;
+        pthread_cond_signal(&server.not_empty);
+        pthread_mutex_unlock(&server.lock);
+    }
+
+    /* Stops workers, waking up those blocked on a client */
+    pthread_mutex_lock(&server.lock);
+    server.is_stopping = 1;
+    for (t = 0; t < n_threads; ++t) {
+        if (server.workers[t].client >= 0) {
+            shutdown(server.workers[t].client, SHUT_RDWR);
+        }
+    }
+    pthread_cond_broadcast(&server.not_empty);
+    pthread_mutex_unlock(&server.lock);
+    for (t = 0; t < n_threads; ++t) {
+        pthread_join(server.workers[t].thread, NULL);
+    }
+    pthread_kill(signal_thread, SIGTERM);
+    pthread_join(signal_thread, NULL);
+    for (i = 0; i < server.queue_size; ++i) {
+        close(server.queue[(server.queue_first + i) % QUEUE_SIZE]);
+    }
+    close(server.listener);
+    unlink(argv[1]);
+
+    report(stderr, &server);
+    if (is_counting) {
+        counters_print(stderr);
+    }
+
+    /* Frees memory */
+    for (t = 0; t < n_threads; ++t) {
+        struct worker *worker = server.workers + t;
+
+        free(worker->points);
+        free(worker->labels);
+        free(worker->tree_labels);
+        free(worker->votes);
+        free(worker->stable);
+        free(worker->reached);
+        free(worker->columns);
+        free(worker->epsilons);
+    }
+    free(server.workers);
+    free(server.latencies);
+    pthread_mutex_destroy(&server.lock);
+    pthread_cond_destroy(&server.not_empty);
+    pthread_cond_destroy(&server.not_full);
+    for (i = 0; i < server.n_models; ++i) {
+        model_delete(server.models[i]);
+        if (is_forest[i]) {
+            for (t = 0; t < forests[i].n_trees; ++t) {
+                decision_tree_delete(forests[i].trees[t]);
+            }
+            forest_delete(forests + i);
+        }
+        else {
+            decision_tree_delete(trees[i]);
+        }
+        dataset_delete(headers[i]);
+    }
+    free(server.models);
+    free(trees);
+    free(forests);
+    free(is_forest);
+    free(headers);
+
+    return EXIT_SUCCESS;
+}
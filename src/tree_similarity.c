@@ -3,25 +3,72 @@
 #include <string.h>
 
 #include "data/dataset.h"
+#include "data_structures/counters.h"
 #include "decision_tree/decision_tree.h"
 #include "decision_tree/mapper/silva.h"
+#include "decision_tree/performance/performance.h"
 #include "data_structures/distribution.h"
 
 
+/***********************************************************************
+ * Support functions.
+ **********************************************************************/
+
+/* Compares trees sample by sample, on correctness and stability */
+static void display_agreement(FILE *stream, const DecisionTree tree_1, const DecisionTree tree_2, const Dataset dataset, const double epsilon) {
+    Perturbation perturbation;
+    Performance performance;
+    Outcomes outcomes_1, outcomes_2;
+
+    perturbation.epsilon = epsilon;
+    perturbation.scales = NULL;
+    perturbation.boxes = NULL;
+    outcomes_create(&outcomes_1, dataset.size);
+    outcomes_create(&outcomes_2, dataset.size);
+    decision_tree_outcomes(&outcomes_1, tree_1, dataset, perturbation, NULL);
+    decision_tree_outcomes(&outcomes_2, tree_2, dataset, perturbation, NULL);
+
+    fprintf(stream, "Outcome agreement (epsilon: %g): %g\n", epsilon, outcomes_agreement(outcomes_1, outcomes_2));
+    outcomes_performance(&performance, outcomes_1);
+    fprintf(stream, "  first tree:     ");
+    decision_tree_performance_print(stream, performance);
+    outcomes_performance(&performance, outcomes_2);
+    fprintf(stream, "  second tree:    ");
+    decision_tree_performance_print(stream, performance);
+
+    outcomes_delete(outcomes_1);
+    outcomes_delete(outcomes_2);
+}
+
+
+
+
+
 /***********************************************************************
  * Main entry point.
  **********************************************************************/
 
 int main(int argc, char *argv[]) {
+    const unsigned int is_counting = counters_requested(&argc, argv);
     DecisionTree tree_1, tree_2;
     Dataset dataset;
     FILE *stream;
+    double epsilon = 0.0;
+    char *end;
 
     /* Checks input */
     if (argc < 4) {
-        fprintf(stderr, "Usage: %s <first tree path> <second tree path> <dataset path>\n", argv[0]);
+        fprintf(stderr, "Usage: %s <first tree path> <second tree path> <dataset path> [epsilon] [--counters]\n", argv[0]);
+        fprintf(stderr, "  epsilon  Also compares correctness and stability of trees on each sample\n");
         exit(EXIT_FAILURE);
     }
+    if (argc > 4) {
+        epsilon = strtod(argv[4], &end);
+        if (end == argv[4] || *end != '\0' || !(epsilon >= 0.0)) {
+            fprintf(stderr, "Epsilon \"%s\" is not a non-negative number.\n", argv[4]);
+            exit(EXIT_FAILURE);
+        }
+    }
 
     /* Reads dataset */
     stream = fopen(argv[3], "r");
@@ -38,6 +85,12 @@ int main(int argc, char *argv[]) {
 
     /* Displays information */
     printf("Similarity: %g\n", decision_tree_similarity(tree_1, tree_2, dataset));
+    if (argc > 4) {
+        display_agreement(stdout, tree_1, tree_2, dataset, epsilon);
+    }
+    if (is_counting) {
+        counters_print(stderr);
+    }
 
     /* Frees memory */
     dataset_delete(dataset);